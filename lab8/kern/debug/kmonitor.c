@@ -4,6 +4,12 @@
 #include <trap.h>
 #include <kmonitor.h>
 #include <kdebug.h>
+#include <kmalloc.h>
+#include <slab.h>
+#include <kmtrace.h>
+#include <proc.h>
+#include <sem.h>
+#include <lockstat.h>
 
 /* *
  * Simple command-line kernel monitor useful for controlling the
@@ -21,6 +27,12 @@ static struct command commands[] = {
     {"help", "Display this list of commands.", mon_help},
     {"kerninfo", "Display information about the kernel.", mon_kerninfo},
     {"backtrace", "Print backtrace of stack frame.", mon_backtrace},
+    {"slabinfo", "Display slab cache usage and fragmentation.", mon_slabinfo},
+    {"kmbench", "Benchmark kmalloc/kfree, optional arg: rounds.", mon_kmbench},
+    {"kmtrace", "kmalloc call-site tracing: on|off|reset|top [n]|live|hist.", mon_kmtrace},
+    {"top", "Display cpu time and run queue delay of the processes.", mon_top},
+    {"lockstat", "Display lock contention statistics, optional arg: reset.", mon_lockstat},
+    {"syncbench", "Benchmark uncontended lock/unlock pairs, optional arg: rounds.", mon_syncbench},
 };
 
 /* return if kernel is panic, in kern/debug/panic.c */
@@ -130,3 +142,85 @@ mon_backtrace(int argc, char **argv, struct trapframe *tf) {
     return 0;
 }
 
+/* mon_slabinfo - print the per-cache report of the slab allocator */
+int
+mon_slabinfo(int argc, char **argv, struct trapframe *tf) {
+    slab_print_info();
+    return 0;
+}
+
+/* mon_kmbench - run the kmalloc/kfree microbenchmark */
+int
+mon_kmbench(int argc, char **argv, struct trapframe *tf) {
+    int nr_rounds = (argc > 0) ? strtol(argv[0], NULL, 10) : 100;
+    if (nr_rounds <= 0) {
+        cprintf("usage: kmbench [rounds]\n");
+        return 0;
+    }
+    kmalloc_bench(nr_rounds);
+    return 0;
+}
+
+/* mon_syncbench - run the uncontended lock/unlock microbenchmark */
+int
+mon_syncbench(int argc, char **argv, struct trapframe *tf) {
+    int nr_rounds = (argc > 0) ? strtol(argv[0], NULL, 10) : 10000;
+    if (nr_rounds <= 0) {
+        cprintf("usage: syncbench [rounds]\n");
+        return 0;
+    }
+    sync_bench(nr_rounds);
+    return 0;
+}
+
+/* mon_lockstat - print the lock contention statistics, or reset them */
+int
+mon_lockstat(int argc, char **argv, struct trapframe *tf) {
+    if (argc == 0) {
+        lockstat_print();
+    }
+    else if (strcmp(argv[0], "reset") == 0) {
+        lockstat_reset();
+    }
+    else {
+        cprintf("usage: lockstat [reset]\n");
+    }
+    return 0;
+}
+
+/* mon_kmtrace - control kmalloc call-site tracing and print its reports */
+int
+mon_kmtrace(int argc, char **argv, struct trapframe *tf) {
+    if (argc == 0) {
+        cprintf("kmtrace is %s.\n", kmtrace_enabled ? "on" : "off");
+    }
+    else if (strcmp(argv[0], "on") == 0) {
+        kmtrace_start();
+    }
+    else if (strcmp(argv[0], "off") == 0) {
+        kmtrace_stop();
+    }
+    else if (strcmp(argv[0], "reset") == 0) {
+        kmtrace_reset();
+    }
+    else if (strcmp(argv[0], "top") == 0) {
+        kmtrace_print_top((argc > 1) ? strtol(argv[1], NULL, 10) : 10);
+    }
+    else if (strcmp(argv[0], "live") == 0) {
+        kmtrace_print_live();
+    }
+    else if (strcmp(argv[0], "hist") == 0) {
+        kmtrace_print_hist();
+    }
+    else {
+        cprintf("usage: kmtrace [on|off|reset|top [n]|live|hist]\n");
+    }
+    return 0;
+}
+
+/* mon_top - print the cpu accounting of the processes */
+int
+mon_top(int argc, char **argv, struct trapframe *tf) {
+    proc_print_top();
+    return 0;
+}
@@ -8,6 +8,12 @@ void kmonitor(struct trapframe *tf);
 int mon_help(int argc, char **argv, struct trapframe *tf);
 int mon_kerninfo(int argc, char **argv, struct trapframe *tf);
 int mon_backtrace(int argc, char **argv, struct trapframe *tf);
+int mon_slabinfo(int argc, char **argv, struct trapframe *tf);
+int mon_kmbench(int argc, char **argv, struct trapframe *tf);
+int mon_kmtrace(int argc, char **argv, struct trapframe *tf);
+int mon_top(int argc, char **argv, struct trapframe *tf);
+int mon_lockstat(int argc, char **argv, struct trapframe *tf);
+int mon_syncbench(int argc, char **argv, struct trapframe *tf);
 int mon_continue(int argc, char **argv, struct trapframe *tf);
 int mon_step(int argc, char **argv, struct trapframe *tf);
 int mon_breakpoint(int argc, char **argv, struct trapframe *tf);
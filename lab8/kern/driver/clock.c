@@ -3,28 +3,30 @@
 #include <sbi.h>
 #include <stdio.h>
 #include <riscv.h>
+#include <time.h>
+#include <cpu.h>
 
 volatile size_t ticks;
 
-static inline uint64_t get_cycles(void) {
-#if __riscv_xlen == 64
-    uint64_t n;
-    __asm__ __volatile__("rdtime %0" : "=r"(n));
-    return n;
-#else
-    uint32_t lo, hi, tmp;
-    __asm__ __volatile__(
-        "1:\n"
-        "rdtimeh %0\n"
-        "rdtime %1\n"
-        "rdtimeh %2\n"
-        "bne %0, %2, 1b"
-        : "=&r"(hi), "=&r"(lo), "=&r"(tmp));
-    return ((uint64_t)hi << 32) | lo;
-#endif
-}
+static uint64_t timebase = CLOCK_TICK_CYCLES;
+// per cpu: rdtime of the next periodic tick, ticks stay on this grid even when the tick is stopped
+static uint64_t next_tick[NCPU];
+// per cpu: when the tick wants the next interrupt: next_tick, or later while the tick is stopped
+static uint64_t tick_event[NCPU];
+// the earliest hrtimer deadline, the hrtimers are run by the boot cpu
+static uint64_t hrtimer_event = (uint64_t)-1;
+// rdtime at clock_init, the start of clock_ns
+static uint64_t boot_cycles;
 
-static uint64_t timebase = 100000;
+// clock_program - arm the timer of this cpu for the tick or the first hrtimer, whichever is earlier
+static void clock_program(void) {
+    int id = mycpu()->id;
+    uint64_t event = tick_event[id];
+    if (id == 0 && hrtimer_event < event) {
+        event = hrtimer_event;
+    }
+    sbi_set_timer(event);
+}
 
 /* *
  * clock_init - initialize 8253 clock to interrupt 100 times per second,
@@ -33,6 +35,8 @@ static uint64_t timebase = 100000;
 void clock_init(void) {
     set_csr(sie, MIP_STIP);
 
+    boot_cycles = get_cycles();
+    next_tick[0] = boot_cycles + timebase;
     clock_set_next_event();
     // initialize time counter 'ticks' to zero
     ticks = 0;
@@ -40,4 +44,85 @@ void clock_init(void) {
     cprintf("++ setup timer interrupts\n");
 }
 
-void clock_set_next_event(void) { sbi_set_timer(get_cycles() + timebase); }
+// clock_init_cpu - start the periodic tick of a secondary cpu, on the grid of the boot cpu
+void clock_init_cpu(void) {
+    set_csr(sie, MIP_STIP);
+
+    uint64_t now = get_cycles();
+    next_tick[mycpu()->id] = now - (now - boot_cycles) % timebase + timebase;
+    clock_set_next_event();
+}
+
+void clock_set_next_event(void) {
+    int id = mycpu()->id;
+    tick_event[id] = next_tick[id];
+    clock_program();
+}
+
+/* *
+ * clock_elapsed_ticks - called by the timer interrupt, return the # of
+ * ticks passed since the last call and arm the timer for the next tick.
+ * That is 1 normally, more after the tick was stopped, and 0 if the
+ * interrupt came early.
+ * */
+int clock_elapsed_ticks(void) {
+    uint64_t now = get_cycles(), *next = next_tick + mycpu()->id;
+    int n = 0;
+    while (now >= *next) {
+        *next += timebase;
+        n ++;
+    }
+    clock_set_next_event();
+    return n;
+}
+
+/* *
+ * clock_stop_tick - for an idle cpu: skip the periodic ticks and arm the
+ * timer @nr_ticks ticks from now. The next interrupt catches them up.
+ * */
+void clock_stop_tick(unsigned int nr_ticks) {
+    int id = mycpu()->id;
+    if (nr_ticks > 1) {
+        tick_event[id] = next_tick[id] + (nr_ticks - 1) * timebase;
+        clock_program();
+    }
+}
+
+/* *
+ * clock_kick - a timer was added on a secondary cpu: the boot cpu runs the
+ * timers but may have stopped its tick past it, make it re-arm its timer.
+ * */
+void clock_kick(void) {
+    if (!cpu_is_boot() && cpus[0].proc == cpus[0].idle) {
+        smp_send_ipi(cpus, IPI_TIMER);
+    }
+}
+
+// clock_set_hrtimer_event - the first hrtimer deadline changed, (uint64_t)-1 if none
+void clock_set_hrtimer_event(uint64_t deadline) {
+    hrtimer_event = deadline;
+    // before clock_init the timer interrupt is off, it is armed there
+    if (tick_event[0] != 0) {
+        if (cpu_is_boot()) {
+            clock_program();
+        }
+        else {
+            smp_send_ipi(cpus, IPI_TIMER);
+        }
+    }
+}
+
+// clock_ns - nanoseconds since clock_init, from the rdtime counter
+uint64_t clock_ns(void) {
+    return cycles_to_ns(get_cycles() - boot_cycles);
+}
+
+// cycles_to_ns - convert a duration in rdtime cycles to nanoseconds
+uint64_t cycles_to_ns(uint64_t cycles) {
+    return cycles / CLOCK_FREQ * NSEC_PER_SEC + cycles % CLOCK_FREQ * NSEC_PER_SEC / CLOCK_FREQ;
+}
+
+// ns_to_cycles - convert a duration in nanoseconds to rdtime cycles, rounding up
+uint64_t ns_to_cycles(uint64_t ns) {
+    return ns / NSEC_PER_SEC * CLOCK_FREQ + (ns % NSEC_PER_SEC * CLOCK_FREQ + NSEC_PER_SEC - 1) / NSEC_PER_SEC;
+}
@@ -3,9 +3,40 @@
 
 #include <defs.h>
 
+// the rdtime counter runs at 10MHz, and the timer interrupts 100 times per second
+#define CLOCK_FREQ                  10000000
+#define CLOCK_TICK_CYCLES           (CLOCK_FREQ / 100)
+
 extern volatile size_t ticks;
 
+// get_cycles - read the free-running time counter (rdtime)
+static inline uint64_t get_cycles(void) {
+#if __riscv_xlen == 64
+    uint64_t n;
+    __asm__ __volatile__("rdtime %0" : "=r"(n));
+    return n;
+#else
+    uint32_t lo, hi, tmp;
+    __asm__ __volatile__(
+        "1:\n"
+        "rdtimeh %0\n"
+        "rdtime %1\n"
+        "rdtimeh %2\n"
+        "bne %0, %2, 1b"
+        : "=&r"(hi), "=&r"(lo), "=&r"(tmp));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
 void clock_init(void);
+void clock_init_cpu(void);
 void clock_set_next_event(void);
+int clock_elapsed_ticks(void);
+void clock_stop_tick(unsigned int nr_ticks);
+void clock_kick(void);
+void clock_set_hrtimer_event(uint64_t deadline);
+uint64_t clock_ns(void);
+uint64_t ns_to_cycles(uint64_t ns);
+uint64_t cycles_to_ns(uint64_t cycles);
 
 #endif /* !__KERN_DRIVER_CLOCK_H__ */
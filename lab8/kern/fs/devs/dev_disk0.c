@@ -1,9 +1,10 @@
 #include <defs.h>
 #include <mmu.h>
-#include <sem.h>
+#include <mutex.h>
 #include <ide.h>
 #include <inode.h>
 #include <kmalloc.h>
+#include <vmalloc.h>
 #include <dev.h>
 #include <vfs.h>
 #include <iobuf.h>
@@ -15,16 +16,16 @@
 #define DISK0_BLK_NSECT                 (DISK0_BLKSIZE / SECTSIZE)
 
 static char *disk0_buffer;
-static semaphore_t disk0_sem;
+static mutex_t disk0_mutex;
 
 static void
 lock_disk0(void) {
-    down(&(disk0_sem));
+    mutex_lock(&disk0_mutex);
 }
 
 static void
 unlock_disk0(void) {
-    up(&(disk0_sem));
+    mutex_unlock(&disk0_mutex);
 }
 
 static int
@@ -120,10 +121,11 @@ disk0_device_init(struct device *dev) {
     dev->d_close = disk0_close;
     dev->d_io = disk0_io;
     dev->d_ioctl = disk0_ioctl;
-    sem_init(&(disk0_sem), 1);
+    mutex_init(&disk0_mutex);
+    lockstat_set_class(&disk0_mutex, "disk0");
 
     static_assert(DISK0_BUFSIZE % DISK0_BLKSIZE == 0);
-    if ((disk0_buffer = kmalloc(DISK0_BUFSIZE)) == NULL) {
+    if ((disk0_buffer = vmalloc(DISK0_BUFSIZE)) == NULL) {
         panic("disk0 alloc buffer failed.\n");
     }
 }
@@ -0,0 +1,82 @@
+#include <defs.h>
+#include <stdio.h>
+#include <dev.h>
+#include <vfs.h>
+#include <iobuf.h>
+#include <inode.h>
+#include <unistd.h>
+#include <error.h>
+#include <assert.h>
+#include <kmalloc.h>
+#include <lockstat.h>
+
+/* *
+ * lockstat: - the lock contention statistics as text, the same table as
+ * the kmonitor command lockstat. Reading renders them anew at the file
+ * offset, writing anything resets the counters.
+ * */
+
+#define LOCKSTAT_BUFSIZE            (4 * 1024)
+
+static int
+lockstat_open(struct device *dev, uint32_t open_flags) {
+    if (open_flags != O_RDONLY && open_flags != O_WRONLY) {
+        return -E_INVAL;
+    }
+    return 0;
+}
+
+static int
+lockstat_close(struct device *dev) {
+    return 0;
+}
+
+static int
+lockstat_io(struct device *dev, struct iobuf *iob, bool write) {
+    if (write) {
+        lockstat_reset();
+        iob->io_resid = 0;
+        return 0;
+    }
+    char *buf;
+    if ((buf = kmalloc(LOCKSTAT_BUFSIZE)) == NULL) {
+        return -E_NO_MEM;
+    }
+    // a short read is fine, the rest comes at the next offset
+    size_t len = lockstat_snprint(buf, LOCKSTAT_BUFSIZE);
+    if (iob->io_offset >= 0 && iob->io_offset < len) {
+        iobuf_move(iob, buf + iob->io_offset, len - iob->io_offset, 1, NULL);
+    }
+    kfree(buf);
+    return 0;
+}
+
+static int
+lockstat_ioctl(struct device *dev, int op, void *data) {
+    return -E_INVAL;
+}
+
+static void
+lockstat_device_init(struct device *dev) {
+    dev->d_blocks = 0;
+    dev->d_blocksize = 1;
+    dev->d_open = lockstat_open;
+    dev->d_close = lockstat_close;
+    dev->d_io = lockstat_io;
+    dev->d_ioctl = lockstat_ioctl;
+}
+
+void
+dev_init_lockstat(void) {
+    struct inode *node;
+    if ((node = dev_create_inode()) == NULL) {
+        panic("lockstat: dev_create_node.\n");
+    }
+    lockstat_device_init(vop_info(node, device));
+
+    int ret;
+    if ((ret = vfs_add_dev("lockstat", node, 0)) != 0) {
+        panic("lockstat: vfs_add_dev: %e.\n", ret);
+    }
+}
+
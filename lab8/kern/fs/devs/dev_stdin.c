@@ -36,6 +36,12 @@ dev_stdin_write(char c) {
     }
 }
 
+// dev_stdin_waiting - is any process waiting for console input, which is polled on ticks
+bool
+dev_stdin_waiting(void) {
+    return !wait_queue_empty(wait_queue);
+}
+
 static int
 dev_stdin_read(char *buf, size_t len) {
     int ret = 0;
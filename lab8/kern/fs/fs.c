@@ -1,6 +1,6 @@
 #include <defs.h>
 #include <kmalloc.h>
-#include <sem.h>
+#include <mutex.h>
 #include <vfs.h>
 #include <dev.h>
 #include <file.h>
@@ -22,12 +22,12 @@ fs_cleanup(void) {
 
 void
 lock_files(struct files_struct *filesp) {
-    down(&(filesp->files_sem));
+    mutex_lock(&(filesp->files_mutex));
 }
 
 void
 unlock_files(struct files_struct *filesp) {
-    up(&(filesp->files_sem));
+    mutex_unlock(&(filesp->files_mutex));
 }
 //Called when a new proc init
 struct files_struct *
@@ -39,7 +39,8 @@ files_create(void) {
         filesp->pwd = NULL;
         filesp->fd_array = (void *)(filesp + 1);
         filesp->files_count = 0;
-        sem_init(&(filesp->files_sem), 1);
+        mutex_init(&(filesp->files_mutex));
+        lockstat_set_class(&(filesp->files_mutex), "files");
         fd_array_init(filesp->fd_array);
     }
     return filesp;
@@ -3,7 +3,7 @@
 
 #include <defs.h>
 #include <mmu.h>
-#include <sem.h>
+#include <mutex.h>
 #include <atomic.h>
 
 #define SECTSIZE            512
@@ -26,7 +26,8 @@ struct files_struct {
     struct inode *pwd;      // inode of present working directory
     struct file *fd_array;  // opened files array
     int files_count;        // the number of opened files
-    semaphore_t files_sem;  // lock protect sem
+    mutex_t files_mutex;    // protects fd_array and pwd
+    list_entry_t reap_link; // entry in the reaper's list once the last user exited
 };
 
 #define FILES_STRUCT_BUFSIZE                       (PGSIZE - sizeof(struct files_struct))
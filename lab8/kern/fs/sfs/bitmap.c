@@ -2,6 +2,7 @@
 #include <string.h>
 #include <bitmap.h>
 #include <kmalloc.h>
+#include <vmalloc.h>
 #include <error.h>
 #include <assert.h>
 
@@ -27,7 +28,7 @@ bitmap_create(uint32_t nbits) {
 
     uint32_t nwords = ROUNDUP_DIV(nbits, WORD_BITS);
     WORD_TYPE *map;
-    if ((map = kmalloc(sizeof(WORD_TYPE) * nwords)) == NULL) {
+    if ((map = vmalloc(sizeof(WORD_TYPE) * nwords)) == NULL) {
         kfree(bitmap);
         return NULL;
     }
@@ -99,7 +100,7 @@ bitmap_free(struct bitmap *bitmap, uint32_t index) {
 // bitmap_destroy - free memory contains bitmap
 void
 bitmap_destroy(struct bitmap *bitmap) {
-    kfree(bitmap->map);
+    vfree(bitmap->map);
     kfree(bitmap);
 }
 
@@ -4,7 +4,8 @@
 #include <defs.h>
 #include <mmu.h>
 #include <list.h>
-#include <sem.h>
+#include <mutex.h>
+#include <rwsem.h>
 #include <unistd.h>
 
 /*
@@ -71,7 +72,7 @@ struct sfs_inode {
     uint32_t ino;                                   /* inode number */
     bool dirty;                                     /* true if inode modified */
     int reclaim_count;                              /* kill inode if it hits zero */
-    semaphore_t sem;                                /* semaphore for din */
+    rwsem_t rwsem;                                  /* rwsem for din and the data */
     list_entry_t inode_link;                        /* entry for linked-list in sfs_fs */
     list_entry_t hash_link;                         /* entry for hash linked-list in sfs_fs */
 };
@@ -86,9 +87,9 @@ struct sfs_fs {
     struct bitmap *freemap;                         /* blocks in use are mared 0 */
     bool super_dirty;                               /* true if super/freemap modified */
     void *sfs_buffer;                               /* buffer for non-block aligned io */
-    semaphore_t fs_sem;                             /* semaphore for fs */
-    semaphore_t io_sem;                             /* semaphore for io */
-    semaphore_t mutex_sem;                          /* semaphore for link/unlink and rename */
+    mutex_t fs_mutex;                               /* mutex for fs */
+    mutex_t io_mutex;                               /* mutex for io */
+    mutex_t link_mutex;                             /* mutex for link/unlink and rename */
     list_entry_t inode_list;                        /* inode linked-list */
     list_entry_t *hash_list;                        /* inode hash linked-list */
 };
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <kmalloc.h>
+#include <vmalloc.h>
 #include <list.h>
 #include <fs.h>
 #include <vfs.h>
@@ -69,7 +70,7 @@ sfs_unmount(struct fs *fs) {
     assert(!sfs->super_dirty);
     bitmap_destroy(sfs->freemap);
     kfree(sfs->sfs_buffer);
-    kfree(sfs->hash_list);
+    vfree(sfs->hash_list);
     kfree(sfs);
     return 0;
 }
@@ -197,7 +198,7 @@ sfs_do_mount(struct device *dev, struct fs **fs_store) {
 
     /* alloc and initialize hash list */
     list_entry_t *hash_list;
-    if ((sfs->hash_list = hash_list = kmalloc(sizeof(list_entry_t) * SFS_HLIST_SIZE)) == NULL) {
+    if ((sfs->hash_list = hash_list = vmalloc(sizeof(list_entry_t) * SFS_HLIST_SIZE)) == NULL) {
         goto failed_cleanup_sfs_buffer;
     }
     for (i = 0; i < SFS_HLIST_SIZE; i ++) {
@@ -225,9 +226,12 @@ sfs_do_mount(struct device *dev, struct fs **fs_store) {
 
     /* and other fields */
     sfs->super_dirty = 0;
-    sem_init(&(sfs->fs_sem), 1);
-    sem_init(&(sfs->io_sem), 1);
-    sem_init(&(sfs->mutex_sem), 1);
+    mutex_init(&(sfs->fs_mutex));
+    mutex_init(&(sfs->io_mutex));
+    mutex_init(&(sfs->link_mutex));
+    lockstat_set_class(&(sfs->fs_mutex), "sfs_fs");
+    lockstat_set_class(&(sfs->io_mutex), "sfs_io");
+    lockstat_set_class(&(sfs->link_mutex), "sfs_link");
     list_init(&(sfs->inode_list));
     cprintf("sfs: mount: '%s' (%d/%d/%d)\n", sfs->super.info,
             blocks - unused_blocks, unused_blocks, blocks);
@@ -243,7 +247,7 @@ sfs_do_mount(struct device *dev, struct fs **fs_store) {
 failed_cleanup_freemap:
     bitmap_destroy(freemap);
 failed_cleanup_hash_list:
-    kfree(hash_list);
+    vfree(hash_list);
 failed_cleanup_sfs_buffer:
     kfree(sfs_buffer);
 failed_cleanup_fs:
@@ -12,6 +12,7 @@
 #include <bitmap.h>
 #include <error.h>
 #include <assert.h>
+#include <preempt.h>
 
 static const struct inode_ops sfs_node_dirops;  // dir operations
 static const struct inode_ops sfs_node_fileops; // file operations
@@ -21,7 +22,7 @@ static const struct inode_ops sfs_node_fileops; // file operations
  */
 static void
 lock_sin(struct sfs_inode *sin) {
-    down(&(sin->sem));
+    down_write(&(sin->rwsem));
 }
 
 /*
@@ -29,7 +30,20 @@ lock_sin(struct sfs_inode *sin) {
  */
 static void
 unlock_sin(struct sfs_inode *sin) {
-    up(&(sin->sem));
+    up_write(&(sin->rwsem));
+}
+
+/*
+ * lock_sin_read - lock the inode shared, for reading the file or a directory
+ */
+static void
+lock_sin_read(struct sfs_inode *sin) {
+    down_read(&(sin->rwsem));
+}
+
+static void
+unlock_sin_read(struct sfs_inode *sin) {
+    up_read(&(sin->rwsem));
 }
 
 /*
@@ -118,7 +132,8 @@ sfs_create_inode(struct sfs_fs *sfs, struct sfs_disk_inode *din, uint32_t ino, s
         vop_init(node, sfs_get_ops(din->type), info2fs(sfs, sfs));
         struct sfs_inode *sin = vop_info(node, sfs_inode);
         sin->din = din, sin->ino = ino, sin->dirty = 0, sin->reclaim_count = 1;
-        sem_init(&(sin->sem), 1);
+        rwsem_init(&(sin->rwsem));
+        lockstat_set_class(&(sin->rwsem), "sfs_inode");
         *node_store = node;
         return 0;
     }
@@ -499,11 +514,11 @@ static int
 sfs_lookup_once(struct sfs_fs *sfs, struct sfs_inode *sin, const char *name, struct inode **node_store, int *slot) {
     int ret;
     uint32_t ino;
-    lock_sin(sin);
+    lock_sin_read(sin);
     {   // find the NO. of disk block and logical index of file entry
         ret = sfs_dirent_search_nolock(sfs, sin, name, &ino, slot, NULL);
     }
-    unlock_sin(sin);
+    unlock_sin_read(sin);
     if (ret == 0) {
 		// load the content of inode with the the NO. of disk block
         ret = sfs_load_inode(sfs, node_store, ino);
@@ -620,7 +635,13 @@ sfs_io(struct inode *node, struct iobuf *iob, bool write) {
     struct sfs_fs *sfs = fsop_info(vop_fs(node), sfs);
     struct sfs_inode *sin = vop_info(node, sfs_inode);
     int ret;
-    lock_sin(sin);
+    // readers share the inode, writers may allocate blocks and grow din->size
+    if (write) {
+        lock_sin(sin);
+    }
+    else {
+        lock_sin_read(sin);
+    }
     {
         size_t alen = iob->io_resid;
         ret = sfs_io_nolock(sfs, sin, iob->io_base, iob->io_offset, &alen, write);
@@ -628,7 +649,12 @@ sfs_io(struct inode *node, struct iobuf *iob, bool write) {
             iobuf_skip(iob, alen);
         }
     }
-    unlock_sin(sin);
+    if (write) {
+        unlock_sin(sin);
+    }
+    else {
+        unlock_sin_read(sin);
+    }
     return ret;
 }
 
@@ -718,11 +744,11 @@ sfs_namefile(struct inode *node, struct iobuf *iob) {
         node = parent, sin = vop_info(node, sfs_inode);
         assert(ino != sin->ino && sin->din->type == SFS_TYPE_DIR);
 
-        lock_sin(sin);
+        lock_sin_read(sin);
         {
             ret = sfs_dirent_findino_nolock(sfs, sin, ino, entry);
         }
-        unlock_sin(sin);
+        unlock_sin_read(sin);
 
         if (ret != 0) {
             goto failed;
@@ -794,12 +820,12 @@ sfs_getdirentry(struct inode *node, struct iobuf *iob) {
         kfree(entry);
         return -E_NOENT;
     }
-    lock_sin(sin);
+    lock_sin_read(sin);
     if ((ret = sfs_getdirentry_sub_nolock(sfs, sin, slot, entry)) != 0) {
-        unlock_sin(sin);
+        unlock_sin_read(sin);
         goto out;
     }
-    unlock_sin(sin);
+    unlock_sin_read(sin);
     ret = iobuf_move(iob, entry->name, sfs_dentry_size, 1, NULL);
 out:
     kfree(entry);
@@ -914,6 +940,7 @@ sfs_truncfile(struct inode *node, off_t len) {
                 goto out_unlock;
             }
             nblks ++;
+            cond_resched();
         }
     }
     else if (tblks < nblks) {
@@ -923,6 +950,7 @@ sfs_truncfile(struct inode *node, off_t len) {
                 goto out_unlock;
             }
             nblks --;
+            cond_resched();
         }
     }
     assert(din->blocks == tblks);
@@ -1,5 +1,5 @@
 #include <defs.h>
-#include <sem.h>
+#include <mutex.h>
 #include <sfs.h>
 
 
@@ -10,7 +10,7 @@
  */
 void
 lock_sfs_fs(struct sfs_fs *sfs) {
-    down(&(sfs->fs_sem));
+    mutex_lock(&(sfs->fs_mutex));
 }
 
 /*
@@ -20,7 +20,7 @@ lock_sfs_fs(struct sfs_fs *sfs) {
  */
 void
 lock_sfs_io(struct sfs_fs *sfs) {
-    down(&(sfs->io_sem));
+    mutex_lock(&(sfs->io_mutex));
 }
 
 /*
@@ -30,7 +30,7 @@ lock_sfs_io(struct sfs_fs *sfs) {
  */
 void
 unlock_sfs_fs(struct sfs_fs *sfs) {
-    up(&(sfs->fs_sem));
+    mutex_unlock(&(sfs->fs_mutex));
 }
 
 /*
@@ -40,5 +40,5 @@ unlock_sfs_fs(struct sfs_fs *sfs) {
  */
 void
 unlock_sfs_io(struct sfs_fs *sfs) {
-    up(&(sfs->io_sem));
+    mutex_unlock(&(sfs->io_mutex));
 }
@@ -12,6 +12,7 @@
 #include <unistd.h>
 #include <error.h>
 #include <assert.h>
+#include <preempt.h>
 
 #define IOBUF_SIZE                          4096
 
@@ -23,12 +24,12 @@ copy_path(char **to, const char *from) {
     if ((buffer = kmalloc(FS_MAX_FPATH_LEN + 1)) == NULL) {
         return -E_NO_MEM;
     }
-    lock_mm(mm);
+    lock_mm_read(mm);
     if (!copy_string(mm, buffer, from, FS_MAX_FPATH_LEN + 1)) {
-        unlock_mm(mm);
+        unlock_mm_read(mm);
         goto failed_cleanup;
     }
-    unlock_mm(mm);
+    unlock_mm_read(mm);
     *to = buffer;
     return 0;
 
@@ -79,7 +80,8 @@ sysfile_read(int fd, void *base, size_t len) {
         }
         ret = file_read(fd, buffer, alen, &alen);
         if (alen != 0) {
-            lock_mm(mm);
+            lock_mm_read(mm);
+            preempt_enable();
             {
                 if (copy_to_user(mm, base, buffer, alen)) {
                     assert(len >= alen);
@@ -89,11 +91,13 @@ sysfile_read(int fd, void *base, size_t len) {
                     ret = -E_INVAL;
                 }
             }
-            unlock_mm(mm);
+            preempt_disable();
+            unlock_mm_read(mm);
         }
         if (ret != 0 || alen == 0) {
             goto out;
         }
+        cond_resched();
     }
 
 out:
@@ -125,13 +129,15 @@ sysfile_write(int fd, void *base, size_t len) {
         if ((alen = IOBUF_SIZE) > len) {
             alen = len;
         }
-        lock_mm(mm);
+        lock_mm_read(mm);
+        preempt_enable();
         {
             if (!copy_from_user(mm, buffer, base, alen, 0)) {
                 ret = -E_INVAL;
             }
         }
-        unlock_mm(mm);
+        preempt_disable();
+        unlock_mm_read(mm);
         if (ret == 0) {
             ret = file_write(fd, buffer, alen, &alen);
             if (alen != 0) {
@@ -142,6 +148,7 @@ sysfile_write(int fd, void *base, size_t len) {
         if (ret != 0 || alen == 0) {
             goto out;
         }
+        cond_resched();
     }
 
 out:
@@ -168,13 +175,13 @@ sysfile_fstat(int fd, struct stat *__stat) {
         return ret;
     }
 
-    lock_mm(mm);
+    lock_mm_read(mm);
     {
         if (!copy_to_user(mm, __stat, stat, sizeof(struct stat))) {
             ret = -E_INVAL;
         }
     }
-    unlock_mm(mm);
+    unlock_mm_read(mm);
     return ret;
 }
 
@@ -253,14 +260,14 @@ sysfile_getcwd(char *buf, size_t len) {
     }
 
     int ret = -E_INVAL;
-    lock_mm(mm);
+    lock_mm_read(mm);
     {
         if (user_mem_check(mm, (uintptr_t)buf, len, 1)) {
             struct iobuf __iob, *iob = iobuf_init(&__iob, buf, len, 0);
             ret = vfs_getcwd(iob);
         }
     }
-    unlock_mm(mm);
+    unlock_mm_read(mm);
     return ret;
 }
 
@@ -274,25 +281,25 @@ sysfile_getdirentry(int fd, struct dirent *__direntp) {
     }
 
     int ret = 0;
-    lock_mm(mm);
+    lock_mm_read(mm);
     {
         if (!copy_from_user(mm, &(direntp->offset), &(__direntp->offset), sizeof(direntp->offset), 1)) {
             ret = -E_INVAL;
         }
     }
-    unlock_mm(mm);
+    unlock_mm_read(mm);
 
     if (ret != 0 || (ret = file_getdirentry(fd, direntp)) != 0) {
         goto out;
     }
 
-    lock_mm(mm);
+    lock_mm_read(mm);
     {
         if (!copy_to_user(mm, __direntp, direntp, sizeof(struct dirent))) {
             ret = -E_INVAL;
         }
     }
-    unlock_mm(mm);
+    unlock_mm_read(mm);
 
 out:
     kfree(direntp);
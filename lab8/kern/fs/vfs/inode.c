@@ -7,6 +7,20 @@
 #include <error.h>
 #include <assert.h>
 #include <kmalloc.h>
+#include <slab.h>
+
+static struct kmem_cache *inode_cachep;
+
+/* *
+ * inode_cache_init - create the cache all inodes are allocated from
+ * invoked by vfs_init
+ * */
+void
+inode_cache_init(void) {
+    if ((inode_cachep = kmem_cache_create("inode", sizeof(struct inode), 0, NULL)) == NULL) {
+        panic("cannot create inode cache.\n");
+    }
+}
 
 /* *
  * __alloc_inode - alloc a inode structure and initialize in_type
@@ -14,7 +28,7 @@
 struct inode *
 __alloc_inode(int type) {
     struct inode *node;
-    if ((node = kmalloc(sizeof(struct inode))) != NULL) {
+    if ((node = kmem_cache_alloc(inode_cachep)) != NULL) {
         node->in_type = type;
     }
     return node;
@@ -40,7 +54,7 @@ void
 inode_kill(struct inode *node) {
     assert(inode_ref_count(node) == 0);
     assert(inode_open_count(node) == 0);
-    kfree(node);
+    kmem_cache_free(inode_cachep, node);
 }
 
 /* *
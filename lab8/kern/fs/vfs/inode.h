@@ -68,6 +68,7 @@ int inode_ref_dec(struct inode *node);
 int inode_open_inc(struct inode *node);
 int inode_open_dec(struct inode *node);
 
+void inode_cache_init(void);
 void inode_init(struct inode *node, const struct inode_ops *ops, struct fs *fs);
 void inode_kill(struct inode *node);
 
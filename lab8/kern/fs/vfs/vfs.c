@@ -3,11 +3,11 @@
 #include <string.h>
 #include <vfs.h>
 #include <inode.h>
-#include <sem.h>
+#include <mutex.h>
 #include <kmalloc.h>
 #include <error.h>
 #include <proc.h>
-static semaphore_t bootfs_sem;
+static mutex_t bootfs_mutex;
 static struct inode *bootfs_node = NULL;
 
 extern void vfs_devlist_init(void);
@@ -25,19 +25,21 @@ __alloc_fs(int type) {
 // vfs_init -  vfs initialize
 void
 vfs_init(void) {
-    sem_init(&bootfs_sem, 1);
+    mutex_init(&bootfs_mutex);
+    lockstat_set_class(&bootfs_mutex, "bootfs");
+    inode_cache_init();
     vfs_devlist_init();
 }
 
 // lock_bootfs - lock  for bootfs
 static void
 lock_bootfs(void) {
-    down(&bootfs_sem);
+    mutex_lock(&bootfs_mutex);
 }
 // ulock_bootfs - ulock for bootfs
 static void
 unlock_bootfs(void) {
-    up(&bootfs_sem);
+    mutex_unlock(&bootfs_mutex);
 }
 
 // change_bootfs - set the new fs inode 
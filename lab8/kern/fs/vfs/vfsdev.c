@@ -4,7 +4,7 @@
 #include <vfs.h>
 #include <dev.h>
 #include <inode.h>
-#include <sem.h>
+#include <mutex.h>
 #include <list.h>
 #include <kmalloc.h>
 #include <unistd.h>
@@ -24,22 +24,23 @@ typedef struct {
     to_struct((le), vfs_dev_t, member)
 
 static list_entry_t vdev_list;     // device info list in vfs layer
-static semaphore_t vdev_list_sem;
+static mutex_t vdev_list_mutex;
 
 static void
 lock_vdev_list(void) {
-    down(&vdev_list_sem);
+    mutex_lock(&vdev_list_mutex);
 }
 
 static void
 unlock_vdev_list(void) {
-    up(&vdev_list_sem);
+    mutex_unlock(&vdev_list_mutex);
 }
 
 void
 vfs_devlist_init(void) {
     list_init(&vdev_list);
-    sem_init(&vdev_list_sem, 1);
+    mutex_init(&vdev_list_mutex);
+    lockstat_set_class(&vdev_list_mutex, "vdev_list");
 }
 
 // vfs_cleanup - finally clean (or sync) fs
@@ -14,15 +14,18 @@
 #include <proc.h>
 #include <kmonitor.h>
 #include <fs.h>
+#include <cpu.h>
+#include <futex.h>
 
-int kern_init(void) __attribute__((noreturn));
+int kern_init(uintptr_t hartid) __attribute__((noreturn));
 void grade_backtrace(void);
 static void lab1_switch_test(void);
 
 int
-kern_init(void) {
+kern_init(uintptr_t hartid) {
     extern char edata[], end[];
     memset(edata, 0, end - edata);
+    smp_boot_cpu(hartid);       // this hart is cpu0, it holds the kernel lock
     cons_init();                // init the console
 
     const char *message = "(THU.CST) os is loading ...";
@@ -39,6 +42,8 @@ kern_init(void) {
 
     vmm_init();                 // init virtual memory management
     sched_init();
+    fpu_init();                 // check the FP register save and restore
+    futex_init();
     proc_init();                // init process table
     
     ide_init();                 // init ide devices
@@ -46,6 +51,7 @@ kern_init(void) {
     fs_init();
 
     clock_init();               // init clock interrupt
+    smp_init();                 // start the other harts
     intr_enable();              // enable irq interrupt
 
     cpu_idle();                 // run idle process
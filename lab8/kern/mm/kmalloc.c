@@ -3,303 +3,225 @@
 #include <memlayout.h>
 #include <assert.h>
 #include <kmalloc.h>
+#include <slab.h>
+#include <kmtrace.h>
 #include <sync.h>
 #include <pmm.h>
 #include <stdio.h>
+#include <string.h>
+#include <clock.h>
 
-/*
- * SLOB Allocator: Simple List Of Blocks
+/* *
+ * kmalloc/kfree on top of the slab allocator
  *
- * Matt Mackall <mpm@selenic.com> 12/30/03
- *
- * How SLOB works:
- *
- * The core of SLOB is a traditional K&R style heap allocator, with
- * support for returning aligned objects. The granularity of this
- * allocator is 8 bytes on x86, though it's perhaps possible to reduce
- * this to 4 if it's deemed worth the effort. The slob heap is a
- * singly-linked list of pages from __get_free_page, grown on demand
- * and allocation from the heap is currently first-fit.
- *
- * Above this is an implementation of kmalloc/kfree. Blocks returned
- * from kmalloc are 8-byte aligned and prepended with a 8-byte header.
- * If kmalloc is asked for objects of PAGE_SIZE or larger, it calls
- * __get_free_pages directly so that it can return page-aligned blocks
- * and keeps a linked list of such pages and their orders. These
- * objects are detected in kfree() by their page alignment.
- *
- * SLAB is emulated on top of SLOB by simply calling constructors and
- * destructors for every SLAB allocation. Objects are returned with
- * the 8-byte alignment unless the SLAB_MUST_HWCACHE_ALIGN flag is
- * set, in which case the low-level allocator will fragment blocks to
- * create the proper alignment. Again, objects of page-size or greater
- * are allocated by calling __get_free_pages. As SLAB objects know
- * their size, no separate size bookkeeping is necessary and there is
- * essentially no allocation space overhead.
- */
-
-
-//some helper
-#define spin_lock_irqsave(l, f) local_intr_save(f)
-#define spin_unlock_irqrestore(l, f) local_intr_restore(f)
-typedef unsigned int gfp_t;
-#ifndef PAGE_SIZE
-#define PAGE_SIZE PGSIZE
-#endif
-
-#ifndef L1_CACHE_BYTES
-#define L1_CACHE_BYTES 64
-#endif
-
-#ifndef ALIGN
-#define ALIGN(addr,size)   (((addr)+(size)-1)&(~((size)-1))) 
-#endif
-
-
-struct slob_block {
-	int units;
-	struct slob_block *next;
-};
-typedef struct slob_block slob_t;
-
-#define SLOB_UNIT sizeof(slob_t)
-#define SLOB_UNITS(size) (((size) + SLOB_UNIT - 1)/SLOB_UNIT)
-#define SLOB_ALIGN L1_CACHE_BYTES
-
-struct bigblock {
-	int order;
-	void *pages;
-	struct bigblock *next;
+ * Small requests are rounded up to one of the size classes below and
+ * served from the matching "kmalloc-N" cache, so they carry no per-object
+ * header: kfree finds the cache through the slab header at the start of
+ * the object's page. Requests above the largest class go straight to the
+ * page allocator and are returned page aligned; since slab objects never
+ * are, kfree tells the two apart by the alignment of the pointer. The
+ * order of such a block is kept in the struct Page of its first page
+ * (PG_bigblock set, order in property), so kfree and ksize find it in O(1).
+ * */
+
+// the largest class still fits two objects into a one-page slab
+#define KMALLOC_MAX_SLAB            2016
+
+static const size_t kmalloc_sizes[] = {
+    32, 64, 96, 128, 192, 256, 384, 512, 1024, KMALLOC_MAX_SLAB,
 };
-typedef struct bigblock bigblock_t;
-
-static slob_t arena = { .next = &arena, .units = 1 };
-static slob_t *slobfree = &arena;
-static bigblock_t *bigblocks;
-
-
-static void* __slob_get_free_pages(gfp_t gfp, int order)
-{
-  struct Page * page = alloc_pages(1 << order);
-  if(!page)
-    return NULL;
-  return page2kva(page);
-}
-
-#define __slob_get_free_page(gfp) __slob_get_free_pages(gfp, 0)
-
-static inline void __slob_free_pages(unsigned long kva, int order)
-{
-  free_pages(kva2page(kva), 1 << order);
-}
-
-static void slob_free(void *b, int size);
-
-static void *slob_alloc(size_t size, gfp_t gfp, int align)
-{
-  assert( (size + SLOB_UNIT) < PAGE_SIZE );
-
-	slob_t *prev, *cur, *aligned = 0;
-	int delta = 0, units = SLOB_UNITS(size);
-	unsigned long flags;
-
-	spin_lock_irqsave(&slob_lock, flags);
-	prev = slobfree;
-	for (cur = prev->next; ; prev = cur, cur = cur->next) {
-		if (align) {
-			aligned = (slob_t *)ALIGN((unsigned long)cur, align);
-			delta = aligned - cur;
-		}
-		if (cur->units >= units + delta) { /* room enough? */
-			if (delta) { /* need to fragment head to align? */
-				aligned->units = cur->units - delta;
-				aligned->next = cur->next;
-				cur->next = aligned;
-				cur->units = delta;
-				prev = cur;
-				cur = aligned;
-			}
-
-			if (cur->units == units) /* exact fit? */
-				prev->next = cur->next; /* unlink */
-			else { /* fragment */
-				prev->next = cur + units;
-				prev->next->units = cur->units - units;
-				prev->next->next = cur->next;
-				cur->units = units;
-			}
-
-			slobfree = prev;
-			spin_unlock_irqrestore(&slob_lock, flags);
-			return cur;
-		}
-		if (cur == slobfree) {
-			spin_unlock_irqrestore(&slob_lock, flags);
-
-			if (size == PAGE_SIZE) /* trying to shrink arena? */
-				return 0;
-
-			cur = (slob_t *)__slob_get_free_page(gfp);
-			if (!cur)
-				return 0;
-
-			slob_free(cur, PAGE_SIZE);
-			spin_lock_irqsave(&slob_lock, flags);
-			cur = slobfree;
-		}
-	}
-}
 
-static void slob_free(void *block, int size)
-{
-	slob_t *cur, *b = (slob_t *)block;
-	unsigned long flags;
+#define KMALLOC_NR_CLASSES          (sizeof(kmalloc_sizes) / sizeof(kmalloc_sizes[0]))
 
-	if (!block)
-		return;
-
-	if (size)
-		b->units = SLOB_UNITS(size);
-
-	/* Find reinsertion point */
-	spin_lock_irqsave(&slob_lock, flags);
-	for (cur = slobfree; !(b > cur && b < cur->next); cur = cur->next)
-		if (cur >= cur->next && (b > cur || b < cur->next))
-			break;
-
-	if (b + b->units == cur->next) {
-		b->units += cur->next->units;
-		b->next = cur->next->next;
-	} else
-		b->next = cur->next;
-
-	if (cur + cur->units == b) {
-		cur->units += b->units;
-		cur->next = b->next;
-	} else
-		cur->next = b;
-
-	slobfree = cur;
-
-	spin_unlock_irqrestore(&slob_lock, flags);
-}
+static struct kmem_cache *kmalloc_caches[KMALLOC_NR_CLASSES];
+static char kmalloc_names[KMALLOC_NR_CLASSES][CACHE_NAMELEN];
 
+static size_t bigblock_pages;
 
+static void check_kmalloc(void);
 
 void
-slob_init(void) {
-  cprintf("use SLOB allocator\n");
-}
-
-inline void 
 kmalloc_init(void) {
-    slob_init();
+    slab_init();
+    int i;
+    for (i = 0; i < KMALLOC_NR_CLASSES; i ++) {
+        snprintf(kmalloc_names[i], CACHE_NAMELEN, "kmalloc-%d", kmalloc_sizes[i]);
+        if ((kmalloc_caches[i] = kmem_cache_create(kmalloc_names[i], kmalloc_sizes[i], 0, NULL)) == NULL) {
+            panic("cannot create %s.\n", kmalloc_names[i]);
+        }
+    }
+    check_slab();
+    check_kmalloc();
     cprintf("kmalloc_init() succeeded!\n");
 }
 
-size_t
-slob_allocated(void) {
-  return 0;
-}
-
 size_t
 kallocated(void) {
-   return slob_allocated();
+    return slab_allocated() + bigblock_pages * PGSIZE;
 }
 
-static int find_order(int size)
-{
-	int order = 0;
-	for ( ; size > 4096 ; size >>=1)
-		order++;
-	return order;
+static int
+find_order(size_t size) {
+    int order = 0;
+    while ((PGSIZE << order) < size) {
+        order ++;
+    }
+    return order;
 }
 
-static void *__kmalloc(size_t size, gfp_t gfp)
-{
-	slob_t *m;
-	bigblock_t *bb;
-	unsigned long flags;
-
-	if (size < PAGE_SIZE - SLOB_UNIT) {
-		m = slob_alloc(size + SLOB_UNIT, gfp, 0);
-		return m ? (void *)(m + 1) : 0;
-	}
-
-	bb = slob_alloc(sizeof(bigblock_t), gfp, 0);
-	if (!bb)
-		return 0;
-
-	bb->order = find_order(size);
-	bb->pages = (void *)__slob_get_free_pages(gfp, bb->order);
-
-	if (bb->pages) {
-		spin_lock_irqsave(&block_lock, flags);
-		bb->next = bigblocks;
-		bigblocks = bb;
-		spin_unlock_irqrestore(&block_lock, flags);
-		return bb->pages;
-	}
+static struct kmem_cache *
+kmalloc_cache(size_t size) {
+    int i;
+    for (i = 0; i < KMALLOC_NR_CLASSES; i ++) {
+        if (size <= kmalloc_sizes[i]) {
+            return kmalloc_caches[i];
+        }
+    }
+    return NULL;
+}
 
-	slob_free(bb, sizeof(bigblock_t));
-	return 0;
+static void *
+__kmalloc(size_t size) {
+    struct kmem_cache *cachep;
+    if ((cachep = kmalloc_cache(size)) != NULL) {
+        return kmem_cache_alloc(cachep);
+    }
+
+    struct Page *page;
+    int order = find_order(size);
+    if ((page = alloc_pages(1 << order)) == NULL) {
+        return NULL;
+    }
+    SetPageBigblock(page);
+    page->property = order;
+
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        bigblock_pages += (1 << order);
+    }
+    local_intr_restore(intr_flag);
+    return page2kva(page);
 }
 
 void *
-kmalloc(size_t size)
-{
-  return __kmalloc(size, 0);
+kmalloc(size_t size) {
+    void *objp = __kmalloc(size);
+    if (kmtrace_enabled && objp != NULL) {
+        kmtrace_alloc(objp, size, (uintptr_t)__builtin_return_address(0));
+    }
+    return objp;
 }
 
-
-void kfree(void *block)
-{
-	bigblock_t *bb, **last = &bigblocks;
-	unsigned long flags;
-
-	if (!block)
-		return;
-
-	if (!((unsigned long)block & (PAGE_SIZE-1))) {
-		/* might be on the big block list */
-		spin_lock_irqsave(&block_lock, flags);
-		for (bb = bigblocks; bb; last = &bb->next, bb = bb->next) {
-			if (bb->pages == block) {
-				*last = bb->next;
-				spin_unlock_irqrestore(&block_lock, flags);
-				__slob_free_pages((unsigned long)block, bb->order);
-				slob_free(bb, sizeof(bigblock_t));
-				return;
-			}
-		}
-		spin_unlock_irqrestore(&block_lock, flags);
-	}
-
-	slob_free((slob_t *)block - 1, 0);
-	return;
+void
+kfree(void *objp) {
+    if (objp == NULL) {
+        return;
+    }
+    if (kmtrace_nr_objs != 0) {
+        kmtrace_free(objp);
+    }
+    if ((uintptr_t)objp % PGSIZE != 0) {
+        struct kmem_cache *cachep = kmem_cache_of(objp);
+        kmem_cache_free(cachep, objp);
+        return;
+    }
+
+    struct Page *page = kva2page(objp);
+    if (!PageBigblock(page)) {
+        panic("kfree: bad pointer %p.\n", objp);
+    }
+    int order = page->property;
+    ClearPageBigblock(page);
+
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        bigblock_pages -= (1 << order);
+    }
+    local_intr_restore(intr_flag);
+    free_pages(page, 1 << order);
 }
 
+size_t
+ksize(const void *objp) {
+    if (objp == NULL) {
+        return 0;
+    }
+    if ((uintptr_t)objp % PGSIZE != 0) {
+        return kmem_cache_size(kmem_cache_of(objp));
+    }
+
+    struct Page *page = kva2page((void *)objp);
+    return PageBigblock(page) ? (PGSIZE << page->property) : 0;
+}
 
-unsigned int ksize(const void *block)
-{
-	bigblock_t *bb;
-	unsigned long flags;
-
-	if (!block)
-		return 0;
-
-	if (!((unsigned long)block & (PAGE_SIZE-1))) {
-		spin_lock_irqsave(&block_lock, flags);
-		for (bb = bigblocks; bb; bb = bb->next)
-			if (bb->pages == block) {
-				spin_unlock_irqrestore(&slob_lock, flags);
-				return PAGE_SIZE << bb->order;
-			}
-		spin_unlock_irqrestore(&block_lock, flags);
-	}
+/* *
+ * kmalloc_bench - allocation microbenchmark, run from the kernel monitor.
+ * For every size class (and one page-sized request), allocate a batch of
+ * objects and free them again, @nr_rounds times, and report the average
+ * cost of one kmalloc and one kfree in timer cycles.
+ * */
+#define KMBENCH_BATCH               64
 
-	return ((slob_t *)block - 1)->units * SLOB_UNIT;
+void
+kmalloc_bench(int nr_rounds) {
+    static void *objs[KMBENCH_BATCH];
+    cprintf("%8s %14s %14s\n", "size", "kmalloc(cyc)", "kfree(cyc)");
+    int i, r, k;
+    for (i = 0; i <= KMALLOC_NR_CLASSES; i ++) {
+        size_t size = (i < KMALLOC_NR_CLASSES) ? kmalloc_sizes[i] : PGSIZE;
+        uint64_t alloc_cycles = 0, free_cycles = 0, nr_ops = 0, start;
+        for (r = 0; r < nr_rounds; r ++) {
+            start = get_cycles();
+            for (k = 0; k < KMBENCH_BATCH; k ++) {
+                if ((objs[k] = kmalloc(size)) == NULL) {
+                    break;
+                }
+            }
+            alloc_cycles += get_cycles() - start;
+            // kmalloc may have failed early, only count the objects that were allocated
+            int n = k;
+            nr_ops += n;
+            start = get_cycles();
+            for (k = 0; k < n; k ++) {
+                kfree(objs[k]);
+            }
+            free_cycles += get_cycles() - start;
+        }
+        if (nr_ops == 0) {
+            cprintf("%8d %14s %14s\n", size, "n/a", "n/a");
+            continue;
+        }
+        cprintf("%8d %14d %14d\n", size, (int)(alloc_cycles / nr_ops), (int)(free_cycles / nr_ops));
+    }
 }
 
-
+// check_kmalloc - check the correctness of kmalloc/kfree
+static void
+check_kmalloc(void) {
+    size_t nr_free_pages_store = nr_free_pages();
+
+    size_t sizes[] = {1, 31, 32, 33, 200, 1000, KMALLOC_MAX_SLAB, KMALLOC_MAX_SLAB + 1, PGSIZE, PGSIZE * 3};
+    void *objs[sizeof(sizes) / sizeof(sizes[0])];
+    int i;
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i ++) {
+        assert((objs[i] = kmalloc(sizes[i])) != NULL);
+        assert(ksize(objs[i]) >= sizes[i]);
+        memset(objs[i], i, sizes[i]);
+    }
+    assert(ksize(objs[0]) == 32 && ksize(objs[3]) == 64);
+    assert((uintptr_t)objs[7] % PGSIZE == 0 && ksize(objs[9]) == PGSIZE * 4);
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i ++) {
+        kfree(objs[i]);
+    }
+
+    // slabs grown above are kept on the per-cache free lists
+    for (i = 0; i < KMALLOC_NR_CLASSES; i ++) {
+        kmem_cache_shrink(kmalloc_caches[i]);
+    }
+    assert(nr_free_pages_store == nr_free_pages());
+
+    cprintf("check_kmalloc() succeeded!\n");
+}
 
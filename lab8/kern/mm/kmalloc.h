@@ -9,8 +9,10 @@ void kmalloc_init(void);
 
 void *kmalloc(size_t n);
 void kfree(void *objp);
+size_t ksize(const void *objp);
 
 size_t kallocated(void);
+void kmalloc_bench(int nr_rounds);
 
 #endif /* !__KERN_MM_KMALLOC_H__ */
 
@@ -0,0 +1,325 @@
+#include <defs.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <sync.h>
+#include <clock.h>
+#include <stdlib.h>
+#include <kmtrace.h>
+
+/* *
+ * kmtrace - kmalloc call-site statistics
+ *
+ * All state is static, so tracing never allocates and cannot recurse
+ * into kmalloc. Two open-addressing tables with linear probing are kept:
+ *   sites - one entry per kmalloc caller (return address), with call
+ *           counts and total/live bytes
+ *   objs  - one entry per live traced object, mapping it back to its site
+ *           and size so kfree can be charged to the right caller
+ * When a table is full the event is counted as dropped instead of
+ * recorded. Objects allocated while tracing was off are unknown to objs,
+ * and freeing them is ignored. Objects traced before kmtrace_stop are
+ * still taken out of objs when freed, so they are not reported as leaks
+ * and their addresses can be traced again.
+ *
+ * Besides that, a log2 histogram of request sizes and a ring of per-second
+ * allocation counts (the allocation rate over the last KMTRACE_NR_RATE
+ * seconds) are kept.
+ * */
+
+#define KMTRACE_SITE_SHIFT          8
+#define KMTRACE_NR_SITES            (1 << KMTRACE_SITE_SHIFT)
+#define KMTRACE_OBJ_SHIFT           12
+#define KMTRACE_NR_OBJS             (1 << KMTRACE_OBJ_SHIFT)
+#define KMTRACE_MAX_OBJS            (KMTRACE_NR_OBJS / 4 * 3)   // keep probe chains short
+#define KMTRACE_NR_SIZE             16                          // size buckets: <= 16B, 32B, ... , > 256KB
+#define KMTRACE_NR_RATE             32                          // # of rate samples kept
+#define KMTRACE_RATE_TICKS          100                         // ticks per rate sample (1s)
+
+struct kmtrace_site {
+    uintptr_t caller;               // return address of the kmalloc call, 0 if unused
+    unsigned int nr_allocs;         // # of objects allocated here
+    unsigned int nr_frees;          // # of those objects freed
+    unsigned int live_objs;         // # of objects not freed yet
+    size_t total_bytes;             // bytes requested here
+    size_t live_bytes;              // bytes requested by live objects
+};
+
+struct kmtrace_obj {
+    const void *objp;               // the object, NULL if unused
+    uint32_t size;                  // size passed to kmalloc
+    uint32_t site;                  // index into sites
+};
+
+volatile bool kmtrace_enabled = 0;
+
+static struct kmtrace_site sites[KMTRACE_NR_SITES];
+static struct kmtrace_obj objs[KMTRACE_NR_OBJS];
+volatile unsigned int kmtrace_nr_objs = 0;
+
+static unsigned int nr_sites;
+static unsigned int nr_dropped_sites, nr_dropped_objs;
+
+static unsigned int size_hist[KMTRACE_NR_SIZE];
+static unsigned int rate_hist[KMTRACE_NR_RATE];
+static size_t rate_epoch;
+
+#define site_hash(caller)           hash32((uint32_t)(caller), KMTRACE_SITE_SHIFT)
+#define obj_hash(objp)              hash32((uint32_t)((uintptr_t)(objp) >> 4), KMTRACE_OBJ_SHIFT)
+
+// site_lookup - find or insert the entry of @caller, return -1 if sites is full
+static int
+site_lookup(uintptr_t caller) {
+    int i = site_hash(caller), n;
+    for (n = 0; n < KMTRACE_NR_SITES; n ++, i = (i + 1) % KMTRACE_NR_SITES) {
+        if (sites[i].caller == caller) {
+            return i;
+        }
+        if (sites[i].caller == 0) {
+            if (nr_sites == KMTRACE_NR_SITES - 1) {
+                break;
+            }
+            sites[i].caller = caller;
+            nr_sites ++;
+            return i;
+        }
+    }
+    return -1;
+}
+
+// obj_remove - delete objs[i], shifting back later entries of the probe chain
+static void
+obj_remove(int i) {
+    int j = i, k;
+    while (1) {
+        j = (j + 1) % KMTRACE_NR_OBJS;
+        if (objs[j].objp == NULL) {
+            break;
+        }
+        k = obj_hash(objs[j].objp);
+        // objs[j] stays if its home slot k lies cyclically in (i, j]
+        if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j)) {
+            continue;
+        }
+        objs[i] = objs[j];
+        i = j;
+    }
+    objs[i].objp = NULL;
+    kmtrace_nr_objs --;
+}
+
+// rate_advance - move the rate ring to the current sample, clearing the skipped ones
+static void
+rate_advance(void) {
+    size_t epoch = ticks / KMTRACE_RATE_TICKS;
+    if (epoch != rate_epoch) {
+        size_t e = rate_epoch;
+        while (e != epoch && e - rate_epoch < KMTRACE_NR_RATE) {
+            rate_hist[(++ e) % KMTRACE_NR_RATE] = 0;
+        }
+        rate_epoch = epoch;
+    }
+}
+
+// kmtrace_alloc - called by kmalloc when tracing is on
+void
+kmtrace_alloc(const void *objp, size_t size, uintptr_t caller) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        int b = 0, s;
+        while (b < KMTRACE_NR_SIZE - 1 && (16 << b) < size) {
+            b ++;
+        }
+        size_hist[b] ++;
+        rate_advance();
+        rate_hist[rate_epoch % KMTRACE_NR_RATE] ++;
+
+        if ((s = site_lookup(caller)) < 0) {
+            nr_dropped_sites ++;
+            goto out;
+        }
+        sites[s].nr_allocs ++;
+        sites[s].total_bytes += size;
+        if (kmtrace_nr_objs >= KMTRACE_MAX_OBJS) {
+            nr_dropped_objs ++;
+            goto out;
+        }
+        int i = obj_hash(objp);
+        while (objs[i].objp != NULL) {
+            i = (i + 1) % KMTRACE_NR_OBJS;
+        }
+        objs[i].objp = objp, objs[i].size = size, objs[i].site = s;
+        kmtrace_nr_objs ++;
+        sites[s].live_objs ++;
+        sites[s].live_bytes += size;
+    }
+out:
+    local_intr_restore(intr_flag);
+}
+
+// kmtrace_free - called by kfree while there are traced objects, even after tracing is off
+void
+kmtrace_free(const void *objp) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        int i = obj_hash(objp);
+        while (objs[i].objp != NULL) {
+            if (objs[i].objp == objp) {
+                struct kmtrace_site *site = sites + objs[i].site;
+                site->nr_frees ++;
+                site->live_objs --;
+                site->live_bytes -= objs[i].size;
+                obj_remove(i);
+                break;
+            }
+            i = (i + 1) % KMTRACE_NR_OBJS;
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+void
+kmtrace_start(void) {
+    kmtrace_enabled = 1;
+}
+
+void
+kmtrace_stop(void) {
+    kmtrace_enabled = 0;
+}
+
+// kmtrace_reset - forget everything recorded so far
+void
+kmtrace_reset(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        memset(sites, 0, sizeof(sites));
+        memset(objs, 0, sizeof(objs));
+        memset(size_hist, 0, sizeof(size_hist));
+        memset(rate_hist, 0, sizeof(rate_hist));
+        nr_sites = kmtrace_nr_objs = 0;
+        nr_dropped_sites = nr_dropped_objs = 0;
+        rate_epoch = ticks / KMTRACE_RATE_TICKS;
+    }
+    local_intr_restore(intr_flag);
+}
+
+/* *
+ * sort_sites - fill @order with the indexes of the used sites, sorted by
+ * total bytes (or live bytes if @live), largest first; return the count.
+ * */
+static int
+sort_sites(int *order, bool live) {
+    int i, j, n = 0;
+    for (i = 0; i < KMTRACE_NR_SITES; i ++) {
+        if (sites[i].caller == 0 || (live && sites[i].live_objs == 0)) {
+            continue;
+        }
+        size_t key = live ? sites[i].live_bytes : sites[i].total_bytes;
+        for (j = n; j > 0; j --) {
+            size_t prev = live ? sites[order[j - 1]].live_bytes : sites[order[j - 1]].total_bytes;
+            if (prev >= key) {
+                break;
+            }
+            order[j] = order[j - 1];
+        }
+        order[j] = i, n ++;
+    }
+    return n;
+}
+
+static void
+print_sites(int *order, int n) {
+    int i;
+    cprintf("%-18s %8s %8s %10s %8s %10s\n", "caller", "allocs", "frees", "bytes", "live", "live-bytes");
+    for (i = 0; i < n; i ++) {
+        struct kmtrace_site *site = sites + order[i];
+        cprintf("0x%016lx %8d %8d %10ld %8d %10ld\n", site->caller, site->nr_allocs,
+                site->nr_frees, site->total_bytes, site->live_objs, site->live_bytes);
+    }
+    if (nr_dropped_sites != 0 || nr_dropped_objs != 0) {
+        cprintf("dropped: %d allocs (site table full), %d objects (object table full)\n",
+                nr_dropped_sites, nr_dropped_objs);
+    }
+}
+
+// kmtrace_print_top - the @n call sites that requested the most bytes
+void
+kmtrace_print_top(int n) {
+    static int order[KMTRACE_NR_SITES];
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        int nr = sort_sites(order, 0);
+        print_sites(order, (n < nr) ? n : nr);
+    }
+    local_intr_restore(intr_flag);
+}
+
+// kmtrace_print_live - leak report: every call site with objects still allocated
+void
+kmtrace_print_live(void) {
+    static int order[KMTRACE_NR_SITES];
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        int i, nr = sort_sites(order, 1);
+        size_t live_bytes = 0;
+        print_sites(order, nr);
+        for (i = 0; i < nr; i ++) {
+            live_bytes += sites[order[i]].live_bytes;
+        }
+        cprintf("total: %d live objects, %ld bytes\n", kmtrace_nr_objs, live_bytes);
+    }
+    local_intr_restore(intr_flag);
+}
+
+static void
+print_bar(unsigned int count, unsigned int max) {
+    int i, len = (max != 0) ? (count * 50 + max - 1) / max : 0;
+    for (i = 0; i < len; i ++) {
+        cputchar('#');
+    }
+    cputchar('\n');
+}
+
+// kmtrace_print_hist - request size histogram and allocation rate of the last seconds
+void
+kmtrace_print_hist(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        int i;
+        unsigned int max = 0;
+        for (i = 0; i < KMTRACE_NR_SIZE; i ++) {
+            max = (size_hist[i] > max) ? size_hist[i] : max;
+        }
+        cprintf("request size:\n");
+        for (i = 0; i < KMTRACE_NR_SIZE; i ++) {
+            if (i < KMTRACE_NR_SIZE - 1) {
+                cprintf("  <= %7d %8d ", 16 << i, size_hist[i]);
+            }
+            else {
+                cprintf("   > %7d %8d ", 16 << (i - 1), size_hist[i]);
+            }
+            print_bar(size_hist[i], max);
+        }
+
+        rate_advance();
+        max = 0;
+        for (i = 0; i < KMTRACE_NR_RATE; i ++) {
+            max = (rate_hist[i] > max) ? rate_hist[i] : max;
+        }
+        cprintf("allocations per %d ticks, oldest first:\n", KMTRACE_RATE_TICKS);
+        for (i = 1; i <= KMTRACE_NR_RATE; i ++) {
+            unsigned int count = rate_hist[(rate_epoch + i) % KMTRACE_NR_RATE];
+            cprintf("  %3d %8d ", i - KMTRACE_NR_RATE, count);
+            print_bar(count, max);
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
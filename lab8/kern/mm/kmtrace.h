@@ -0,0 +1,27 @@
+#ifndef __KERN_MM_KMTRACE_H__
+#define __KERN_MM_KMTRACE_H__
+
+#include <defs.h>
+
+/* *
+ * kmtrace - optional per-callsite accounting of kmalloc/kfree.
+ * When disabled, the cost in kmalloc is one load and branch on
+ * kmtrace_enabled, and in kfree one on kmtrace_nr_objs: objects traced
+ * while it was enabled are still untracked when freed.
+ * */
+extern volatile bool kmtrace_enabled;
+extern volatile unsigned int kmtrace_nr_objs;
+
+void kmtrace_alloc(const void *objp, size_t size, uintptr_t caller);
+void kmtrace_free(const void *objp);
+
+void kmtrace_start(void);
+void kmtrace_stop(void);
+void kmtrace_reset(void);
+
+void kmtrace_print_top(int n);
+void kmtrace_print_live(void);
+void kmtrace_print_hist(void);
+
+#endif /* !__KERN_MM_KMTRACE_H__ */
+
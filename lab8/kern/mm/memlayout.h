@@ -49,6 +49,14 @@
 #define KMEMSIZE            0x7E00000                  // the maximum amount of physical memory
 #define KERNTOP             (KERNBASE + KMEMSIZE)
 
+/* *
+ * Virtually contiguous kernel allocations (vmalloc). The area lies in the
+ * same 1GB top-level entry as the direct map, so its page tables are
+ * shared by every page directory copied from boot_pgdir.
+ * */
+#define VMALLOC_START       0xFFFFFFFFD0000000
+#define VMALLOC_END         0xFFFFFFFFF0000000
+
 #define KERNEL_BEGIN_PADDR 0x80200000
 #define KERNEL_BEGIN_VADDR 0xFFFFFFFFC0200000
 #define PHYSICAL_MEMORY_END 0x88000000
@@ -106,12 +114,17 @@ struct Page {
 #define PG_reserved                 0       // if this bit=1: the Page is reserved for kernel, cannot be used in alloc/free_pages; otherwise, this bit=0 
 #define PG_property                 1       // if this bit=1: the Page is the head page of a free memory block(contains some continuous_addrress pages), and can be used in alloc_pages; if this bit=0: if the Page is the the head page of a free memory block, then this Page and the memory block is alloced. Or this Page isn't the head page.
 
+#define PG_bigblock                 2       // if this bit=1: the Page is the head page of a block returned by kmalloc from alloc_pages, and property holds the order of the block
+
 #define SetPageReserved(page)       set_bit(PG_reserved, &((page)->flags))
 #define ClearPageReserved(page)     clear_bit(PG_reserved, &((page)->flags))
 #define PageReserved(page)          test_bit(PG_reserved, &((page)->flags))
 #define SetPageProperty(page)       set_bit(PG_property, &((page)->flags))
 #define ClearPageProperty(page)     clear_bit(PG_property, &((page)->flags))
 #define PageProperty(page)          test_bit(PG_property, &((page)->flags))
+#define SetPageBigblock(page)       set_bit(PG_bigblock, &((page)->flags))
+#define ClearPageBigblock(page)     clear_bit(PG_bigblock, &((page)->flags))
+#define PageBigblock(page)          test_bit(PG_bigblock, &((page)->flags))
 
 // convert list entry to page
 #define le2page(le, member)                 \
@@ -1,7 +1,9 @@
+#include <cpu.h>
 #include <default_pmm.h>
 #include <defs.h>
 #include <error.h>
 #include <kmalloc.h>
+#include <vmalloc.h>
 #include <memlayout.h>
 #include <mmu.h>
 #include <pmm.h>
@@ -12,6 +14,7 @@
 #include <sync.h>
 #include <vmm.h>
 #include <riscv.h>
+#include <preempt.h>
 
 // virtual address of physical page array
 struct Page *pages;
@@ -256,6 +259,7 @@ void pmm_init(void) {
 
 
     kmalloc_init();
+    vmalloc_init();
 }
 
 // get_pte - get pte and return the kernel virtual address of this pte for la
@@ -382,6 +386,7 @@ void unmap_range(pde_t *pgdir, uintptr_t start, uintptr_t end) {
         if (*ptep != 0) {
             page_remove_pte(pgdir, start, ptep);
         }
+        cond_resched();
         start += PGSIZE;
     } while (start != 0 && start < end);
 }
@@ -490,8 +495,13 @@ int copy_range(pde_t *to, pde_t *from, uintptr_t start, uintptr_t end,
              * (3) memory copy from src_kvaddr to dst_kvaddr, size is PGSIZE
              * (4) build the map of phy addr of  nage with the linear addr start
              */
+            void *src_kvaddr = page2kva(page);
+            void *dst_kvaddr = page2kva(npage);
+            memcpy(dst_kvaddr, src_kvaddr, PGSIZE);
+            ret = page_insert(to, npage, start, perm);
             assert(ret == 0);
         }
+        cond_resched();
         start += PGSIZE;
     } while (start != 0 && start < end);
     return 0;
@@ -537,6 +547,10 @@ int page_insert(pde_t *pgdir, struct Page *page, uintptr_t la, uint32_t perm) {
 // edited are the ones currently in use by the processor.
 void tlb_invalidate(pde_t *pgdir, uintptr_t la) {
     asm volatile("sfence.vma %0" : : "r"(la));
+    // other cpus may run the same mm, or cache the entry from an earlier run of it
+    if (ncpu > 1) {
+        smp_tlb_shootdown(la);
+    }
 }
 
 // pgdir_alloc_page - call alloc_page & page_insert functions to
@@ -0,0 +1,394 @@
+#include <defs.h>
+#include <list.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <sync.h>
+#include <pmm.h>
+#include <slab.h>
+
+/* *
+ * Slab allocator
+ *
+ * A kmem_cache hands out objects of one fixed size. Memory is taken from
+ * the page allocator one page at a time; each page is a slab, which starts
+ * with a small header (struct slab) followed by as many objects as fit.
+ * Free objects of a slab are chained through a pointer stored inside the
+ * object itself, so allocation and free are O(1): pop/push on the free
+ * list of the first partial slab.
+ *
+ * A cache keeps its slabs on three lists:
+ *   slabs_partial - some objects free, allocation is served from here first
+ *   slabs_full    - no object free, never looked at by kmem_cache_alloc
+ *   slabs_free    - every object free; at most SLAB_FREE_LIMIT slabs are
+ *                   kept here, further empty slabs go back to the pmm
+ *
+ * If a constructor is given, it is run on every object when a slab is
+ * grown, and callers are expected to free objects back in their
+ * constructed state. In that case the free-list pointer is stored after
+ * the object so it does not clobber constructed fields.
+ *
+ * Because the header sits at the page start, no object is ever page
+ * aligned; kmalloc relies on this to tell its page-sized blocks apart.
+ * */
+
+#define SLAB_MAGIC                  0x5AB5AB5A
+#define SLAB_FREE_LIMIT             1       // # of empty slabs a cache keeps around
+
+struct slab {
+    uint32_t magic;                 // SLAB_MAGIC, checked when an object is freed
+    unsigned int inuse;             // # of objects handed out from this slab
+    struct kmem_cache *cachep;      // the owner cache
+    void *freelist;                 // first free object
+    list_entry_t slab_link;         // entry in one of the cache's slab lists
+};
+
+#define le2slab(le, member)                 \
+    to_struct((le), struct slab, member)
+
+#define obj2slab(objp)                      \
+    ((struct slab *)ROUNDDOWN((uintptr_t)(objp), PGSIZE))
+
+#define obj_freeptr(cachep, objp)           \
+    (*(void **)((char *)(objp) + (cachep)->freeptr))
+
+// the cache of kmem_cache structures, set up statically in slab_init
+static struct kmem_cache cache_cache;
+
+// list of all caches, for slabinfo
+static list_entry_t cache_list;
+
+static int
+cache_setup(struct kmem_cache *cachep, const char *name, size_t size, size_t align, void (*ctor)(void *)) {
+    if (align == 0) {
+        align = sizeof(void *);
+    }
+    assert(size != 0 && (align & (align - 1)) == 0);
+    if (align < sizeof(void *)) {
+        align = sizeof(void *);
+    }
+
+    size_t freeptr = 0, stride = ROUNDUP(size, align);
+    if (ctor != NULL) {
+        freeptr = ROUNDUP(size, sizeof(void *));
+        stride = ROUNDUP(freeptr + sizeof(void *), align);
+    }
+    size_t offset = ROUNDUP(sizeof(struct slab), align);
+    if (offset + stride > PGSIZE) {
+        return -1;
+    }
+
+    memset(cachep, 0, sizeof(struct kmem_cache));
+    strncpy(cachep->name, name, CACHE_NAMELEN - 1);
+    cachep->objsize = size;
+    cachep->stride = stride;
+    cachep->offset = offset;
+    cachep->freeptr = freeptr;
+    cachep->num = (PGSIZE - offset) / stride;
+    cachep->ctor = ctor;
+    list_init(&(cachep->slabs_full));
+    list_init(&(cachep->slabs_partial));
+    list_init(&(cachep->slabs_free));
+    list_add_before(&cache_list, &(cachep->cache_link));
+    return 0;
+}
+
+// slab_init - set up the cache of caches, called by kmalloc_init
+void
+slab_init(void) {
+    list_init(&cache_list);
+    if (cache_setup(&cache_cache, "kmem_cache", sizeof(struct kmem_cache), 0, NULL) != 0) {
+        panic("cannot setup kmem_cache.\n");
+    }
+}
+
+/* *
+ * kmem_cache_create - create a cache of objects of @size bytes
+ * @align: required object alignment, a power of two; 0 means pointer aligned
+ * @ctor:  optional constructor, run on each object when its slab is grown
+ * Returns NULL if out of memory or if an object does not fit into a page.
+ * */
+struct kmem_cache *
+kmem_cache_create(const char *name, size_t size, size_t align, void (*ctor)(void *)) {
+    struct kmem_cache *cachep;
+    if ((cachep = kmem_cache_alloc(&cache_cache)) != NULL) {
+        bool intr_flag;
+        int ret;
+        local_intr_save(intr_flag);
+        {
+            ret = cache_setup(cachep, name, size, align, ctor);
+        }
+        local_intr_restore(intr_flag);
+        if (ret != 0) {
+            kmem_cache_free(&cache_cache, cachep);
+            cachep = NULL;
+        }
+    }
+    return cachep;
+}
+
+// cache_grow - get a page from pmm, carve it into objects and put it on slabs_free
+static int
+cache_grow(struct kmem_cache *cachep) {
+    struct Page *page;
+    if ((page = alloc_page()) == NULL) {
+        return -1;
+    }
+    struct slab *slabp = page2kva(page);
+    slabp->magic = SLAB_MAGIC;
+    slabp->inuse = 0;
+    slabp->cachep = cachep;
+    slabp->freelist = NULL;
+
+    int i;
+    for (i = cachep->num - 1; i >= 0; i --) {
+        void *objp = (char *)slabp + cachep->offset + i * cachep->stride;
+        if (cachep->ctor != NULL) {
+            cachep->ctor(objp);
+        }
+        obj_freeptr(cachep, objp) = slabp->freelist;
+        slabp->freelist = objp;
+    }
+    list_add(&(cachep->slabs_free), &(slabp->slab_link));
+    cachep->nr_slabs ++, cachep->nr_free_slabs ++;
+    return 0;
+}
+
+// slab_destroy - give an empty slab back to pmm
+static void
+slab_destroy(struct kmem_cache *cachep, struct slab *slabp) {
+    assert(slabp->inuse == 0);
+    list_del(&(slabp->slab_link));
+    slabp->magic = 0;
+    cachep->nr_slabs --;
+    free_page(kva2page(slabp));
+}
+
+// kmem_cache_alloc - take one object from @cachep, growing it by a slab if needed
+void *
+kmem_cache_alloc(struct kmem_cache *cachep) {
+    void *objp = NULL;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *le;
+        if ((le = list_next(&(cachep->slabs_partial))) == &(cachep->slabs_partial)) {
+            if ((le = list_next(&(cachep->slabs_free))) == &(cachep->slabs_free)) {
+                if (cache_grow(cachep) != 0) {
+                    goto out;
+                }
+                le = list_next(&(cachep->slabs_free));
+            }
+            cachep->nr_free_slabs --;
+        }
+        struct slab *slabp = le2slab(le, slab_link);
+        objp = slabp->freelist;
+        slabp->freelist = obj_freeptr(cachep, objp);
+        list_del(le);
+        if (++ slabp->inuse == cachep->num) {
+            list_add(&(cachep->slabs_full), le);
+        }
+        else {
+            list_add(&(cachep->slabs_partial), le);
+        }
+        cachep->nr_active ++, cachep->nr_allocs ++;
+    }
+out:
+    local_intr_restore(intr_flag);
+    return objp;
+}
+
+// kmem_cache_free - give @objp back to the slab it was carved from
+void
+kmem_cache_free(struct kmem_cache *cachep, void *objp) {
+    struct slab *slabp = obj2slab(objp);
+    assert(slabp->magic == SLAB_MAGIC && slabp->cachep == cachep);
+    assert(((uintptr_t)objp - (uintptr_t)slabp - cachep->offset) % cachep->stride == 0);
+
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        assert(slabp->inuse != 0);
+        obj_freeptr(cachep, objp) = slabp->freelist;
+        slabp->freelist = objp;
+        list_del(&(slabp->slab_link));
+        if (-- slabp->inuse == 0) {
+            list_add(&(cachep->slabs_free), &(slabp->slab_link));
+            if (cachep->nr_free_slabs < SLAB_FREE_LIMIT) {
+                cachep->nr_free_slabs ++;
+            }
+            else {
+                slab_destroy(cachep, slabp);
+            }
+        }
+        else {
+            list_add(&(cachep->slabs_partial), &(slabp->slab_link));
+        }
+        cachep->nr_active --, cachep->nr_frees ++;
+    }
+    local_intr_restore(intr_flag);
+}
+
+// kmem_cache_shrink - release all empty slabs of @cachep, return the # of pages freed
+int
+kmem_cache_shrink(struct kmem_cache *cachep) {
+    int nr_pages = 0;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *le;
+        while ((le = list_next(&(cachep->slabs_free))) != &(cachep->slabs_free)) {
+            slab_destroy(cachep, le2slab(le, slab_link));
+            nr_pages ++;
+        }
+        cachep->nr_free_slabs = 0;
+    }
+    local_intr_restore(intr_flag);
+    return nr_pages;
+}
+
+// kmem_cache_destroy - release a cache whose objects have all been freed
+void
+kmem_cache_destroy(struct kmem_cache *cachep) {
+    assert(cachep != &cache_cache);
+    if (cachep->nr_active != 0) {
+        panic("kmem_cache_destroy: %s still has %d objects.\n", cachep->name, cachep->nr_active);
+    }
+    kmem_cache_shrink(cachep);
+    assert(cachep->nr_slabs == 0);
+
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_del(&(cachep->cache_link));
+    }
+    local_intr_restore(intr_flag);
+    kmem_cache_free(&cache_cache, cachep);
+}
+
+// kmem_cache_size - the usable size of an object of @cachep
+size_t
+kmem_cache_size(struct kmem_cache *cachep) {
+    return (cachep->ctor != NULL) ? cachep->objsize : cachep->stride;
+}
+
+// kmem_cache_of - the cache an object returned by kmem_cache_alloc belongs to
+struct kmem_cache *
+kmem_cache_of(const void *objp) {
+    struct slab *slabp = obj2slab(objp);
+    assert(slabp->magic == SLAB_MAGIC);
+    return slabp->cachep;
+}
+
+// slab_allocated - the # of bytes of memory held by all caches
+size_t
+slab_allocated(void) {
+    size_t nr_slabs = 0;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *le = &cache_list;
+        while ((le = list_next(le)) != &cache_list) {
+            nr_slabs += le2cache(le, cache_link)->nr_slabs;
+        }
+    }
+    local_intr_restore(intr_flag);
+    return nr_slabs * PGSIZE;
+}
+
+/* *
+ * slab_print_info - fragmentation report, one line per cache:
+ *   active/total  objects handed out / object slots in all slabs
+ *   slabs(free)   pages owned by the cache, of which are empty
+ *   util          bytes requested by live objects / bytes held by the cache
+ * The gap between util and 100% is header, padding and free-slot waste.
+ * */
+void
+slab_print_info(void) {
+    size_t used = 0, held = 0;
+    cprintf("%-16s %6s %8s %8s %9s %5s %10s %10s\n", "name", "size",
+            "active", "total", "slabs(f)", "util", "allocs", "frees");
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *le = &cache_list;
+        while ((le = list_next(le)) != &cache_list) {
+            struct kmem_cache *cachep = le2cache(le, cache_link);
+            size_t c_used = cachep->nr_active * cachep->objsize;
+            size_t c_held = cachep->nr_slabs * PGSIZE;
+            cprintf("%-16s %6d %8d %8d %5d(%d) %4d%% %10ld %10ld\n", cachep->name,
+                    cachep->objsize, cachep->nr_active, cachep->nr_slabs * cachep->num,
+                    cachep->nr_slabs, cachep->nr_free_slabs,
+                    (c_held != 0) ? (int)(c_used * 100 / c_held) : 100,
+                    cachep->nr_allocs, cachep->nr_frees);
+            used += c_used, held += c_held;
+        }
+    }
+    local_intr_restore(intr_flag);
+    cprintf("total: %d bytes live in %d pages, %d%% utilized\n", used, held / PGSIZE,
+            (held != 0) ? (int)(used * 100 / held) : 100);
+}
+
+static int check_ctor_calls;
+
+static void
+check_ctor(void *objp) {
+    *(uint32_t *)objp = 0xC7C7C7C7;
+    check_ctor_calls ++;
+}
+
+// check_slab - check the correctness of the slab allocator
+void
+check_slab(void) {
+    size_t nr_free_pages_store = nr_free_pages();
+
+    struct kmem_cache *cachep;
+    assert(kmem_cache_create("check_big", PGSIZE, 0, NULL) == NULL);
+    assert((cachep = kmem_cache_create("check_slab", 100, 32, check_ctor)) != NULL);
+    assert(cachep->stride % 32 == 0 && cachep->stride >= 100 + sizeof(void *));
+    assert(kmem_cache_size(cachep) == 100);
+
+    const int n = cachep->num * 3;
+    void *objs[n];
+    int i, j;
+    for (i = 0; i < n; i ++) {
+        assert((objs[i] = kmem_cache_alloc(cachep)) != NULL);
+        assert((uintptr_t)objs[i] % 32 == 0 && (uintptr_t)objs[i] % PGSIZE != 0);
+        assert(*(uint32_t *)objs[i] == 0xC7C7C7C7);
+        assert(kmem_cache_of(objs[i]) == cachep);
+        memset((char *)objs[i] + sizeof(uint32_t), i, 100 - sizeof(uint32_t));
+    }
+    assert(cachep->nr_slabs == 3 && cachep->nr_active == n);
+    assert(check_ctor_calls == n);
+    assert(list_empty(&(cachep->slabs_partial)) && list_empty(&(cachep->slabs_free)));
+    for (i = 0; i < n; i ++) {
+        for (j = sizeof(uint32_t); j < 100; j ++) {
+            assert(((unsigned char *)objs[i])[j] == (unsigned char)i);
+        }
+    }
+
+    // free every other object: all slabs become partial
+    for (i = 0; i < n; i += 2) {
+        kmem_cache_free(cachep, objs[i]);
+    }
+    assert(list_empty(&(cachep->slabs_full)) && !list_empty(&(cachep->slabs_partial)));
+    // the partial slabs are reused before a new one is grown
+    for (i = 0; i < n; i += 2) {
+        assert((objs[i] = kmem_cache_alloc(cachep)) != NULL);
+    }
+    assert(cachep->nr_slabs == 3 && check_ctor_calls == n);
+
+    for (i = 0; i < n; i ++) {
+        kmem_cache_free(cachep, objs[i]);
+    }
+    assert(cachep->nr_active == 0 && cachep->nr_slabs == SLAB_FREE_LIMIT);
+    assert(cachep->nr_free_slabs == SLAB_FREE_LIMIT);
+    assert(kmem_cache_shrink(cachep) == SLAB_FREE_LIMIT && cachep->nr_slabs == 0);
+
+    kmem_cache_destroy(cachep);
+    kmem_cache_shrink(&cache_cache);
+    assert(nr_free_pages_store == nr_free_pages());
+
+    cprintf("check_slab() succeeded!\n");
+}
+
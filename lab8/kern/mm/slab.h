@@ -0,0 +1,54 @@
+#ifndef __KERN_MM_SLAB_H__
+#define __KERN_MM_SLAB_H__
+
+#include <defs.h>
+#include <list.h>
+
+#define CACHE_NAMELEN               16
+
+/* *
+ * struct kmem_cache - a cache of equally sized objects. Each cache owns a
+ * set of one-page slabs, kept on three lists according to how many of
+ * their objects are handed out. A slab's header lives at the start of its
+ * page, so the slab of an object is found by rounding the object address
+ * down to the page boundary.
+ * */
+struct kmem_cache {
+    char name[CACHE_NAMELEN];           // cache name, shown in slabinfo
+    size_t objsize;                     // size requested by the creator
+    size_t stride;                      // distance between two objects in a slab
+    size_t offset;                      // offset of the first object in a slab
+    size_t freeptr;                     // offset of the free-list pointer inside a free object
+    unsigned int num;                   // # of objects per slab
+    void (*ctor)(void *objp);           // optional constructor, run once when a slab is grown
+    list_entry_t slabs_full;            // slabs with no free object
+    list_entry_t slabs_partial;         // slabs with some free objects
+    list_entry_t slabs_free;            // slabs with all objects free
+    unsigned int nr_slabs;              // # of slabs owned by this cache
+    unsigned int nr_free_slabs;         // # of slabs on slabs_free
+    unsigned int nr_active;             // # of objects handed out
+    unsigned long nr_allocs;            // # of successful kmem_cache_alloc calls
+    unsigned long nr_frees;             // # of kmem_cache_free calls
+    list_entry_t cache_link;            // entry in the global cache list
+};
+
+#define le2cache(le, member)                \
+    to_struct((le), struct kmem_cache, member)
+
+void slab_init(void);
+
+struct kmem_cache *kmem_cache_create(const char *name, size_t size, size_t align, void (*ctor)(void *));
+void kmem_cache_destroy(struct kmem_cache *cachep);
+void *kmem_cache_alloc(struct kmem_cache *cachep);
+void kmem_cache_free(struct kmem_cache *cachep, void *objp);
+int kmem_cache_shrink(struct kmem_cache *cachep);
+size_t kmem_cache_size(struct kmem_cache *cachep);
+
+struct kmem_cache *kmem_cache_of(const void *objp);
+size_t slab_allocated(void);
+void slab_print_info(void);
+
+void check_slab(void);
+
+#endif /* !__KERN_MM_SLAB_H__ */
+
@@ -0,0 +1,223 @@
+#include <defs.h>
+#include <list.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <sync.h>
+#include <mmu.h>
+#include <pmm.h>
+#include <kmalloc.h>
+#include <vmalloc.h>
+
+/* *
+ * vmalloc - virtually contiguous kernel memory
+ *
+ * kmalloc serves large requests from alloc_pages, which needs physically
+ * contiguous memory and rounds up to a power of two. vmalloc instead takes
+ * single pages and maps them side by side in [VMALLOC_START, VMALLOC_END),
+ * so a request costs exactly ROUNDUP(size, PGSIZE) of memory and succeeds
+ * as long as enough pages are free anywhere.
+ *
+ * The areas are kept on vmlist sorted by address; a new area goes into
+ * the first gap large enough for it plus one unmapped guard page below
+ * it. The mappings live in boot_pgdir; every page directory shares the
+ * page tables of this range (see setup_pgdir), so the memory is usable
+ * from any process context.
+ *
+ * Use it for big, long-lived buffers that are only touched by the CPU.
+ * Each access goes through a 4K mapping, and vmalloc/vfree change page
+ * tables and flush the TLB, so small or short-lived buffers should stay
+ * with kmalloc.
+ * */
+
+static list_entry_t vmlist;
+static size_t vmalloc_pages;
+
+static void check_vmalloc(void);
+
+void
+vmalloc_init(void) {
+    list_init(&vmlist);
+    check_vmalloc();
+}
+
+/* *
+ * get_vm_area - reserve an area of @size bytes (page aligned) of kernel
+ * virtual space in the vmalloc range, plus the guard page below it. No
+ * memory is mapped yet.
+ * */
+struct vm_struct *
+get_vm_area(size_t size) {
+    struct vm_struct *area;
+    if (size == 0 || size > VMALLOC_END - VMALLOC_START - PGSIZE) {
+        return NULL;
+    }
+    if ((area = kmalloc(sizeof(struct vm_struct))) == NULL) {
+        return NULL;
+    }
+    size = ROUNDUP(size, PGSIZE);
+
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        uintptr_t addr = VMALLOC_START + PGSIZE;
+        list_entry_t *le = &vmlist;
+        while ((le = list_next(le)) != &vmlist) {
+            struct vm_struct *next = le2vm(le, vm_link);
+            if (addr + size <= next->addr - PGSIZE) {
+                break;
+            }
+            addr = next->addr + next->size + PGSIZE;
+        }
+        if (addr + size > VMALLOC_END || addr + size < addr) {
+            local_intr_restore(intr_flag);
+            kfree(area);
+            return NULL;
+        }
+        area->addr = addr, area->size = size;
+        list_add_before(le, &(area->vm_link));
+    }
+    local_intr_restore(intr_flag);
+    return area;
+}
+
+static struct vm_struct *
+find_vm_area(uintptr_t addr) {
+    list_entry_t *le = &vmlist;
+    while ((le = list_next(le)) != &vmlist) {
+        struct vm_struct *area = le2vm(le, vm_link);
+        if (area->addr == addr) {
+            return area;
+        }
+        if (area->addr > addr) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+// free_vm_area - give back an area reserved by get_vm_area, its pages must be unmapped
+void
+free_vm_area(struct vm_struct *area) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_del(&(area->vm_link));
+    }
+    local_intr_restore(intr_flag);
+    kfree(area);
+}
+
+// vunmap_area - unmap and free the pages mapped in [area->addr, area->addr + @size)
+static void
+vunmap_area(struct vm_struct *area, size_t size) {
+    uintptr_t la;
+    for (la = area->addr; la < area->addr + size; la += PGSIZE) {
+        page_remove(boot_pgdir, la);
+    }
+
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        vmalloc_pages -= size / PGSIZE;
+    }
+    local_intr_restore(intr_flag);
+}
+
+// vmalloc - allocate @size bytes of virtually contiguous kernel memory
+void *
+vmalloc(size_t size) {
+    struct vm_struct *area;
+    if ((area = get_vm_area(size)) == NULL) {
+        return NULL;
+    }
+
+    bool intr_flag;
+    size_t mapped;
+    for (mapped = 0; mapped < area->size; mapped += PGSIZE) {
+        struct Page *page;
+        if ((page = alloc_page()) == NULL) {
+            goto failed_cleanup;
+        }
+        if (page_insert(boot_pgdir, page, area->addr + mapped, PTE_R | PTE_W) != 0) {
+            free_page(page);
+            goto failed_cleanup;
+        }
+        local_intr_save(intr_flag);
+        {
+            vmalloc_pages ++;
+        }
+        local_intr_restore(intr_flag);
+    }
+    return (void *)(area->addr);
+
+failed_cleanup:
+    vunmap_area(area, mapped);
+    free_vm_area(area);
+    return NULL;
+}
+
+// vfree - free memory returned by vmalloc
+void
+vfree(const void *addr) {
+    if (addr == NULL) {
+        return;
+    }
+    struct vm_struct *area;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        area = find_vm_area((uintptr_t)addr);
+    }
+    local_intr_restore(intr_flag);
+    if (area == NULL) {
+        panic("vfree: bad address %p.\n", addr);
+    }
+    vunmap_area(area, area->size);
+    free_vm_area(area);
+}
+
+// vmalloc_allocated - the # of bytes of memory mapped by vmalloc
+size_t
+vmalloc_allocated(void) {
+    return vmalloc_pages * PGSIZE;
+}
+
+// check_vmalloc - check the correctness of vmalloc/vfree
+static void
+check_vmalloc(void) {
+    // the first call may allocate the page table of the range, which is never freed
+    vfree(vmalloc(PGSIZE));
+    size_t nr_free_pages_store = nr_free_pages();
+
+    char *p0, *p1, *p2;
+    assert(vmalloc(0) == NULL);
+    assert((p0 = vmalloc(PGSIZE * 3)) != NULL && is_vmalloc_addr(p0));
+    assert((p1 = vmalloc(1)) != NULL && (p2 = vmalloc(PGSIZE * 5 + 1)) != NULL);
+    assert((uintptr_t)p0 % PGSIZE == 0 && p0 >= (char *)VMALLOC_START + PGSIZE);
+    // every area is preceded by an unmapped guard page
+    assert(p1 == p0 + PGSIZE * 4 && p2 == p1 + PGSIZE * 2);
+    pte_t *ptep = get_pte(boot_pgdir, (uintptr_t)p1 - PGSIZE, 0);
+    assert(ptep == NULL || !(*ptep & PTE_V));
+    assert(nr_free_pages_store - nr_free_pages() == 3 + 1 + 6);
+    assert(vmalloc_allocated() == (3 + 1 + 6) * PGSIZE);
+
+    memset(p0, 0x5a, PGSIZE * 3);
+    memset(p2, 0xa5, PGSIZE * 5 + 1);
+    int i;
+    for (i = 0; i < PGSIZE * 3; i ++) {
+        assert(p0[i] == 0x5a);
+    }
+
+    // a freed hole is reused first-fit
+    vfree(p0);
+    char *p3;
+    assert((p3 = vmalloc(PGSIZE * 2)) == p0);
+    vfree(p1), vfree(p2), vfree(p3);
+
+    assert(list_empty(&vmlist) && vmalloc_allocated() == 0);
+    assert(nr_free_pages_store == nr_free_pages());
+
+    cprintf("check_vmalloc() succeeded!\n");
+}
+
@@ -0,0 +1,36 @@
+#ifndef __KERN_MM_VMALLOC_H__
+#define __KERN_MM_VMALLOC_H__
+
+#include <defs.h>
+#include <list.h>
+#include <memlayout.h>
+
+/* *
+ * struct vm_struct - a virtually contiguous kernel area in
+ * [VMALLOC_START, VMALLOC_END). The page below addr is always left
+ * unmapped as a guard, so the area reserves [addr - PGSIZE, addr + size).
+ * */
+struct vm_struct {
+    uintptr_t addr;                 // start of the mapped range
+    size_t size;                    // size of the mapped range, page aligned
+    list_entry_t vm_link;           // entry in vmlist, sorted by addr
+};
+
+#define le2vm(le, member)                   \
+    to_struct((le), struct vm_struct, member)
+
+#define is_vmalloc_addr(addr)               \
+    (VMALLOC_START <= (uintptr_t)(addr) && (uintptr_t)(addr) < VMALLOC_END)
+
+void vmalloc_init(void);
+
+void *vmalloc(size_t size);
+void vfree(const void *addr);
+
+struct vm_struct *get_vm_area(size_t size);
+void free_vm_area(struct vm_struct *area);
+
+size_t vmalloc_allocated(void);
+
+#endif /* !__KERN_MM_VMALLOC_H__ */
+
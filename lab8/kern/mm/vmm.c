@@ -8,6 +8,7 @@
 #include <riscv.h>
 #include <swap.h>
 #include <kmalloc.h>
+#include <slab.h>
 
 /* 
   vmm design include two parts: mm_struct (mm) & vma_struct (vma)
@@ -35,6 +36,8 @@
      void check_pgfault(void);
 */
 
+static struct kmem_cache *mm_cachep, *vma_cachep;
+
 static void check_vmm(void);
 static void check_vma_struct(void);
 static void check_pgfault(void);
@@ -42,7 +45,7 @@ static void check_pgfault(void);
 // mm_create -  alloc a mm_struct & initialize it.
 struct mm_struct *
 mm_create(void) {
-    struct mm_struct *mm = kmalloc(sizeof(struct mm_struct));
+    struct mm_struct *mm = kmem_cache_alloc(mm_cachep);
 
     if (mm != NULL) {
         list_init(&(mm->mmap_list));
@@ -54,7 +57,8 @@ mm_create(void) {
         else mm->sm_priv = NULL;
         
         set_mm_count(mm, 0);
-        sem_init(&(mm->mm_sem), 1);
+        rwsem_init(&(mm->mm_rwsem));
+        lockstat_set_class(&(mm->mm_rwsem), "mm_rwsem");
     }    
     return mm;
 }
@@ -62,7 +66,7 @@ mm_create(void) {
 // vma_create - alloc a vma_struct & initialize it. (addr range: vm_start~vm_end)
 struct vma_struct *
 vma_create(uintptr_t vm_start, uintptr_t vm_end, uint32_t vm_flags) {
-    struct vma_struct *vma = kmalloc(sizeof(struct vma_struct));
+    struct vma_struct *vma = kmem_cache_alloc(vma_cachep);
 
     if (vma != NULL) {
         vma->vm_start = vm_start;
@@ -150,9 +154,9 @@ mm_destroy(struct mm_struct *mm) {
     list_entry_t *list = &(mm->mmap_list), *le;
     while ((le = list_next(list)) != list) {
         list_del(le);
-        kfree(le2vma(le, list_link));  //kfree vma        
+        kmem_cache_free(vma_cachep, le2vma(le, list_link));  //free vma
     }
-    kfree(mm); //kfree mm
+    kmem_cache_free(mm_cachep, mm); //free mm
     mm=NULL;
 }
 
@@ -243,9 +247,14 @@ copy_to_user(struct mm_struct *mm, void *dst, const void *src, size_t len) {
 }
 
 // vmm_init - initialize virtual memory management
-//          - now just call check_vmm to check correctness of vmm
+//          - create the mm_struct & vma_struct caches, then call check_vmm to check correctness of vmm
 void
 vmm_init(void) {
+    mm_cachep = kmem_cache_create("mm_struct", sizeof(struct mm_struct), 0, NULL);
+    vma_cachep = kmem_cache_create("vma_struct", sizeof(struct vma_struct), 0, NULL);
+    if (mm_cachep == NULL || vma_cachep == NULL) {
+        panic("cannot create mm_struct/vma_struct cache.\n");
+    }
     check_vmm();
 }
 
@@ -5,7 +5,7 @@
 #include <list.h>
 #include <memlayout.h>
 #include <sync.h>
-#include <sem.h>
+#include <rwsem.h>
 #include <proc.h>
 //pre define
 struct mm_struct;
@@ -36,8 +36,9 @@ struct mm_struct {
     int map_count;                 // the count of these vma
     void *sm_priv;                 // the private data for swap manager
     int mm_count;                  // the number ofprocess which shared the mm
-    semaphore_t mm_sem; // mutex for using dup_mmap fun to duplicat the mm
+    rwsem_t mm_rwsem;              // held to read the vmas, e.g. to copy from/to user or dup_mmap, or to change them
     int locked_by;
+    list_entry_t reap_link;        // entry in the reaper's list once the last user exited
 };
 
 struct vma_struct *find_vma(struct mm_struct *mm, uintptr_t addr);
@@ -91,7 +92,7 @@ mm_count_dec(struct mm_struct *mm) {
 static inline void
 lock_mm(struct mm_struct *mm) {
     if (mm != NULL) {
-        down(&(mm->mm_sem));
+        down_write(&(mm->mm_rwsem));
         if (current != NULL) {
             mm->locked_by = current->pid;
         }
@@ -101,8 +102,23 @@ lock_mm(struct mm_struct *mm) {
 static inline void
 unlock_mm(struct mm_struct *mm) {
     if (mm != NULL) {
-        up(&(mm->mm_sem));
         mm->locked_by = 0;
+        up_write(&(mm->mm_rwsem));
+    }
+}
+
+// lock_mm_read - lock @mm shared, for anything that only looks at its vmas
+static inline void
+lock_mm_read(struct mm_struct *mm) {
+    if (mm != NULL) {
+        down_read(&(mm->mm_rwsem));
+    }
+}
+
+static inline void
+unlock_mm_read(struct mm_struct *mm) {
+    if (mm != NULL) {
+        up_read(&(mm->mm_rwsem));
     }
 }
 
@@ -0,0 +1,83 @@
+#ifndef __KERN_PROCESS_CPU_H__
+#define __KERN_PROCESS_CPU_H__
+
+#include <riscv.h>
+
+/* *
+ * offsets into struct cpu for trapentry.S: on a trap from user mode
+ * sscratch holds this cpu's struct cpu, the kernel keeps it in tp.
+ * */
+#define CPU_KSTACK                  (0 * REGBYTES)
+#define CPU_TRAP_SP                 (1 * REGBYTES)
+#define CPU_TRAP_T0                 (2 * REGBYTES)
+#define CPU_KSTACK_BASE             (3 * REGBYTES)
+#define CPU_EMERG_STACK             (4 * REGBYTES)
+
+#ifndef __ASSEMBLER__
+
+#include <defs.h>
+#include <sched.h>
+
+#define NCPU                        4       // the most cpus (harts) brought up
+#define MAX_HARTID                  8       // hartids tried by smp_init
+#define EMERG_STACK_SIZE            4096    // the stack of each cpu that kstack_overflow panics on
+
+// the inter-processor interrupts, bits of cpu->ipi_pending
+#define IPI_RESCHED                 0       // something was put on the run queue of an idle cpu
+#define IPI_TIMER                   1       // the boot cpu must re-arm its timer
+
+struct proc_struct;
+
+struct cpu {
+    uintptr_t kstack;               // kernel sp to load on a trap from user mode, must be first
+    uintptr_t trap_sp;              // scratch for trapentry.S, must be second
+    uintptr_t trap_t0;              // scratch for trapentry.S, must be third
+    uintptr_t kstack_base;          // the lowest address of the running process's kstack
+    uintptr_t emerg_stack;          // top of this cpu's stack for kstack_overflow
+    int id;                         // index in cpus[], 0 is the boot cpu
+    uintptr_t hartid;               // the hart id used by SBI
+    struct proc_struct *proc;       // the running process
+    struct proc_struct *idle;       // the idle process of this cpu
+    struct run_queue rq;            // the runnable processes of this cpu
+    volatile unsigned long ipi_pending; // IPI_* requests, set by other cpus
+    struct proc_struct *fpu_owner;  // the process whose state is in the FP registers
+    volatile bool online;
+};
+
+extern struct cpu cpus[NCPU];
+extern int ncpu;
+
+#define rq_cpu(rq)                  to_struct((rq), struct cpu, rq)
+
+// mycpu - the struct cpu of the running cpu, kept in tp
+static inline struct cpu *
+mycpu(void) {
+    struct cpu *cpu;
+    __asm__ __volatile__("mv %0, tp" : "=r"(cpu));
+    return cpu;
+}
+
+static inline bool
+cpu_is_boot(void) {
+    return mycpu()->id == 0;
+}
+
+// cpu_is_idle - @cpu runs its idle process and has nothing to run
+static inline bool
+cpu_is_idle(struct cpu *cpu) {
+    return cpu->online && cpu->proc == cpu->idle && cpu->rq.proc_num == 0;
+}
+
+void smp_boot_cpu(uintptr_t hartid);
+void smp_init(void);
+void smp_send_ipi(struct cpu *cpu, int ipi);
+void smp_ipi_handler(void);
+void smp_tlb_shootdown(uintptr_t la);
+void lock_kernel(void);
+void unlock_kernel(void);
+bool kernel_locked(void);
+
+#endif /* !__ASSEMBLER__ */
+
+#endif /* !__KERN_PROCESS_CPU_H__ */
+
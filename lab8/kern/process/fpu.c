@@ -0,0 +1,160 @@
+#include <defs.h>
+#include <riscv.h>
+#include <string.h>
+#include <sync.h>
+#include <stdio.h>
+#include <assert.h>
+#include <proc.h>
+#include <cpu.h>
+#include <fpu.h>
+
+/* *
+ * Lazy floating-point context switching
+ *
+ * The FP registers of a cpu hold the state of one process, its fpu_owner,
+ * and are only saved and loaded when that has to change. sstatus.FS tells
+ * what happened to them: a process that does not own them returns to user
+ * mode with FS Off, so its first FP instruction traps (an illegal
+ * instruction) and fpu_trap loads its registers. The owner returns with FS
+ * Clean, and the hardware makes it Dirty when user code writes a register;
+ * fpu_switch_out saves the registers only then.
+ *
+ * The kernel itself does not use the FP registers.
+ * */
+
+// in switch.S
+void fpu_save(struct fpu_state *fpu);
+void fpu_restore(struct fpu_state *fpu);
+
+static void check_fpu(void);
+
+static inline uintptr_t
+fs_get(void) {
+    return read_csr(sstatus) & SSTATUS_FS;
+}
+
+static inline void
+fs_set(uintptr_t fs) {
+    clear_csr(sstatus, SSTATUS_FS);
+    set_csr(sstatus, fs);
+}
+
+// fpu_owned - the FP registers of this cpu hold the state of @proc
+static inline bool
+fpu_owned(struct proc_struct *proc) {
+    struct cpu *cpu = mycpu();
+    return cpu->fpu_owner == proc && proc->fpu_cpu == cpu->id;
+}
+
+void
+fpu_init(void) {
+    check_fpu();
+}
+
+// fpu_fork - called by do_fork, @proc starts with a copy of the FP state of current
+void
+fpu_fork(struct proc_struct *proc) {
+    proc->fpu_cpu = -1;
+    if ((proc->fpu_used = current->fpu_used)) {
+        if (fpu_owned(current) && fs_get() == SSTATUS_FS_DIRTY) {
+            fpu_save(&(current->fpu));
+            fs_set(SSTATUS_FS_CLEAN);
+        }
+        proc->fpu = current->fpu;
+    }
+}
+
+// fpu_exec - called by do_execve, the new image starts with FS Off and zeroed registers
+void
+fpu_exec(void) {
+    fpu_exit();
+    current->fpu_used = 0;
+    current->fpu_cpu = -1;
+    current->tf->status = (current->tf->status & ~SSTATUS_FS) | SSTATUS_FS_OFF;
+}
+
+// fpu_exit - current will not use its FP state again
+void
+fpu_exit(void) {
+    if (mycpu()->fpu_owner == current) {
+        mycpu()->fpu_owner = NULL;
+    }
+}
+
+// fpu_switch_out - called by schedule before switching away from @prev
+void
+fpu_switch_out(struct proc_struct *prev) {
+    if (fpu_owned(prev) && fs_get() == SSTATUS_FS_DIRTY) {
+        fpu_save(&(prev->fpu));
+        fs_set(SSTATUS_FS_CLEAN);
+    }
+}
+
+/* *
+ * fpu_trap - an illegal instruction from user mode: if FP was off, it was
+ * the first FP instruction of current since it lost the registers. Load
+ * them and return true, the instruction is run again.
+ * */
+bool
+fpu_trap(struct trapframe *tf) {
+    if ((tf->status & SSTATUS_FS) != SSTATUS_FS_OFF) {
+        return 0;
+    }
+    struct cpu *cpu = mycpu();
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        // the old owner saved its dirty registers when it was switched out
+        fs_set(SSTATUS_FS_CLEAN);
+        if (!fpu_owned(current)) {
+            if (!current->fpu_used) {
+                memset(&(current->fpu), 0, sizeof(struct fpu_state));
+                current->fpu_used = 1;
+            }
+            fpu_restore(&(current->fpu));
+            cpu->fpu_owner = current;
+            current->fpu_cpu = cpu->id;
+            fs_set(SSTATUS_FS_CLEAN);
+        }
+    }
+    local_intr_restore(intr_flag);
+    return 1;
+}
+
+// fpu_return_user - set FS in @tf, which current is about to return to user mode with
+void
+fpu_return_user(struct trapframe *tf) {
+    uintptr_t fs = SSTATUS_FS_OFF;
+    if (fpu_owned(current)) {
+        fs = (fs_get() == SSTATUS_FS_DIRTY) ? SSTATUS_FS_DIRTY : SSTATUS_FS_CLEAN;
+    }
+    tf->status = (tf->status & ~SSTATUS_FS) | fs;
+}
+
+// check_fpu - the registers survive a save and restore, and writing them makes FS dirty
+static void
+check_fpu(void) {
+    static struct fpu_state a, b;
+    int i;
+    for (i = 0; i < 32; i ++) {
+        a.f[i] = 0x0123456789abcdefULL * (i + 1);
+    }
+    a.fcsr = 0x1;           // the NX accrued exception flag
+
+    uintptr_t fs = fs_get();
+    fs_set(SSTATUS_FS_CLEAN);
+    fpu_restore(&a);
+    assert(fs_get() == SSTATUS_FS_DIRTY);
+    fs_set(SSTATUS_FS_CLEAN);
+    fpu_save(&b);
+    assert(fs_get() == SSTATUS_FS_CLEAN);
+    assert(memcmp(&a, &b, sizeof(struct fpu_state)) == 0);
+
+    memset(&a, 0, sizeof(struct fpu_state));
+    fpu_restore(&a);
+    fpu_save(&b);
+    assert(memcmp(&a, &b, sizeof(struct fpu_state)) == 0);
+    fs_set(fs);
+
+    cprintf("check_fpu() succeeded!\n");
+}
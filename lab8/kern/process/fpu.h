@@ -0,0 +1,31 @@
+#ifndef __KERN_PROCESS_FPU_H__
+#define __KERN_PROCESS_FPU_H__
+
+#include <defs.h>
+#include <riscv.h>
+
+// the values of the FS field of sstatus
+#define SSTATUS_FS_OFF              0x00000000      // FP instructions trap
+#define SSTATUS_FS_INITIAL          0x00002000
+#define SSTATUS_FS_CLEAN            0x00004000      // the FP registers match their saved copy
+#define SSTATUS_FS_DIRTY            0x00006000      // the FP registers were written since
+
+// the FP registers of a process, saved when it is switched out with them dirty
+struct fpu_state {
+    uint64_t f[32];
+    uint32_t fcsr;
+};
+
+struct proc_struct;
+struct trapframe;
+
+void fpu_init(void);
+void fpu_fork(struct proc_struct *proc);
+void fpu_exec(void);
+void fpu_exit(void);
+void fpu_switch_out(struct proc_struct *prev);
+bool fpu_trap(struct trapframe *tf);
+void fpu_return_user(struct trapframe *tf);
+
+#endif /* !__KERN_PROCESS_FPU_H__ */
+
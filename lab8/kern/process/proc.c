@@ -1,5 +1,7 @@
 #include <proc.h>
 #include <kmalloc.h>
+#include <slab.h>
+#include <vmalloc.h>
 #include <string.h>
 #include <sync.h>
 #include <pmm.h>
@@ -15,6 +17,15 @@
 #include <fs.h>
 #include <vfs.h>
 #include <sysfile.h>
+#include <clock.h>
+#include <time.h>
+#include <hrtimer.h>
+#include <riscv.h>
+#include <dev.h>
+#include <resource.h>
+#include <preempt.h>
+#include <mutex.h>
+#include <rwsem.h>
 /* ------------- process/thread mechanism design&implementation -------------
 (an simplified Linux process/thread mechanism )
 introduction:
@@ -71,15 +82,13 @@ list_entry_t proc_list;
 // has list for process set based on pid
 static list_entry_t hash_list[HASH_LIST_SIZE];
 
-// idle proc
-struct proc_struct *idleproc = NULL;
 // init proc
 struct proc_struct *initproc = NULL;
-// current proc
-struct proc_struct *current = NULL;
 
 static int nr_process = 0;
 
+static struct kmem_cache *proc_cachep;
+
 void kernel_thread_entry(void);
 void forkrets(struct trapframe *tf);
 void switch_to(struct context *from, struct context *to);
@@ -87,7 +96,7 @@ void switch_to(struct context *from, struct context *to);
 // alloc_proc - alloc a proc_struct and init all fields of proc_struct
 static struct proc_struct *
 alloc_proc(void) {
-    struct proc_struct *proc = kmalloc(sizeof(struct proc_struct));
+    struct proc_struct *proc = kmem_cache_alloc(proc_cachep);
     if (proc != NULL) {
     //LAB4:EXERCISE1 YOUR CODE
     /*
@@ -127,6 +136,38 @@ alloc_proc(void) {
      * below fields(add in LAB6) in proc_struct need to be initialized
      *       struct files_struct * filesp;                file struct point        
      */
+        proc->state = PROC_UNINIT;
+        proc->pid = -1;
+        proc->runs = 0;
+        proc->kstack = 0;
+        proc->need_resched = 0;
+        proc->parent = NULL;
+        proc->mm = NULL;
+        memset(&(proc->context), 0, sizeof(struct context));
+        proc->tf = NULL;
+        proc->cr3 = boot_cr3;
+        proc->flags = 0;
+        memset(proc->name, 0, sizeof(proc->name));
+        proc->exit_code = 0;
+        proc->wait_state = 0;
+        proc->cptr = proc->yptr = proc->optr = NULL;
+        proc->rq = NULL;
+        list_init(&(proc->run_link));
+        proc->time_slice = 0;
+        proc->lab6_run_pool.parent = proc->lab6_run_pool.left = proc->lab6_run_pool.right = NULL;
+        proc->lab6_stride = 0;
+        proc->lab6_priority = 0;
+        proc->filesp = NULL;
+
+        // fields used by the other scheduler classes
+        sched_proc_init(proc);
+        list_init(&(proc->thread_group));
+        proc->fpu_cpu = -1;
+        proc->fpu_used = 0;
+        memset(&(proc->acct), 0, sizeof(struct proc_acct));
+        memset(&(proc->cacct), 0, sizeof(struct proc_acct));
+        proc->acct_stamp = proc->rq_stamp = get_cycles();
+        proc->preempt_count = PREEMPT_KERNEL;
     }
     return proc;
 }
@@ -174,39 +215,44 @@ remove_links(struct proc_struct *proc) {
     nr_process --;
 }
 
-// get_pid - alloc a unique pid for process
+/* *
+ * pid_map - bitmap of the pids in use, a bit is set by get_pid and cleared
+ * by unhash_proc. pid 0 belongs to idleproc and is never handed out.
+ * */
+#define PID_MAP_BITS                64
+#define PID_MAP_WORDS               (MAX_PID / PID_MAP_BITS)
+
+static uint64_t pid_map[PID_MAP_WORDS] = {1};
+static int last_pid = 0;
+
+// get_pid - alloc a unique pid for process, the first free one after the last pid handed out
 static int
 get_pid(void) {
-    static_assert(MAX_PID > MAX_PROCESS);
-    struct proc_struct *proc;
-    list_entry_t *list = &proc_list, *le;
-    static int next_safe = MAX_PID, last_pid = MAX_PID;
-    if (++ last_pid >= MAX_PID) {
-        last_pid = 1;
-        goto inside;
-    }
-    if (last_pid >= next_safe) {
-    inside:
-        next_safe = MAX_PID;
-    repeat:
-        le = list;
-        while ((le = list_next(le)) != list) {
-            proc = le2proc(le, list_link);
-            if (proc->pid == last_pid) {
-                if (++ last_pid >= next_safe) {
-                    if (last_pid >= MAX_PID) {
-                        last_pid = 1;
-                    }
-                    next_safe = MAX_PID;
-                    goto repeat;
-                }
-            }
-            else if (proc->pid > last_pid && next_safe > proc->pid) {
-                next_safe = proc->pid;
+    static_assert(MAX_PID > MAX_PROCESS && MAX_PID % PID_MAP_BITS == 0);
+    int pid = last_pid + 1, n;
+    for (n = 0; n <= PID_MAP_WORDS; n ++) {
+        if (pid >= MAX_PID) {
+            pid = 1;
+        }
+        uint64_t free = ~pid_map[pid / PID_MAP_BITS] >> (pid % PID_MAP_BITS);
+        if (free != 0) {
+            while (!(free & 1)) {
+                free >>= 1, pid ++;
             }
+            pid_map[pid / PID_MAP_BITS] |= (1UL << (pid % PID_MAP_BITS));
+            return last_pid = pid;
         }
+        // no free pid in the rest of this word, go on with the next one
+        pid = (pid / PID_MAP_BITS + 1) * PID_MAP_BITS;
     }
-    return last_pid;
+    panic("get_pid: no free pid.\n");
+}
+
+// put_pid - give back a pid allocated by get_pid
+static void
+put_pid(int pid) {
+    assert(0 < pid && pid < MAX_PID);
+    pid_map[pid / PID_MAP_BITS] &= ~(1UL << (pid % PID_MAP_BITS));
 }
 
 // proc_run - make process "proc" running on cpu
@@ -230,7 +276,19 @@ proc_run(struct proc_struct *proc) {
     *        MACROs or Functions:
      *       flush_tlb():          flush the tlb        
      */
-
+        bool intr_flag;
+        struct proc_struct *prev = current, *next = proc;
+        // the kernel lock goes over to next with the cpu
+        assert(kernel_locked());
+        local_intr_save(intr_flag);
+        {
+            current = next;
+            mycpu()->kstack_base = next->kstack;
+            lcr3(next->cr3);
+            flush_tlb();
+            switch_to(&(prev->context), &(next->context));
+        }
+        local_intr_restore(intr_flag);
     }
 }
 
@@ -239,6 +297,12 @@ proc_run(struct proc_struct *proc) {
 //       after switch_to, the current proc will execute here.
 static void
 forkret(void) {
+    // a new user process leaves the kernel here, a kernel thread stays in it
+    if (!trap_in_kernel(current->tf)) {
+        fpu_return_user(current->tf);
+        sched_acct_system();
+        unlock_kernel();
+    }
     forkrets(current->tf);
 }
 
@@ -248,10 +312,11 @@ hash_proc(struct proc_struct *proc) {
     list_add(hash_list + pid_hashfn(proc->pid), &(proc->hash_link));
 }
 
-// unhash_proc - delete proc from proc hash_list
+// unhash_proc - delete proc from proc hash_list, and free its pid
 static void
 unhash_proc(struct proc_struct *proc) {
     list_del(&(proc->hash_link));
+    put_pid(proc->pid);
 }
 
 // find_proc - find proc frome proc hash_list according to pid
@@ -283,21 +348,77 @@ kernel_thread(int (*fn)(void *), void *arg, uint32_t clone_flags) {
     return do_fork(clone_flags | CLONE_VM, 0, &tf);
 }
 
-// setup_kstack - alloc pages with size KSTACKPAGE as process kernel stack
+/* *
+ * Kernel stacks are vmalloc'ed, so each one has an unmapped guard page
+ * below it and an overflow faults instead of corrupting its neighbour.
+ * __alltraps sees that the trapframe of that fault would not fit on the
+ * stack, and panics through kstack_overflow on the cpu's emergency stack.
+ * Stacks of exited processes are kept mapped on kstack_cache (linked
+ * through their lowest bytes) and handed to the next fork, which then
+ * costs neither page allocation nor page table updates.
+ * */
+#define KSTACK_CACHE_MAX            32      // max # of stacks kept on kstack_cache
+#define KSTACK_CACHE_PREFILL        8       // # of stacks set up by proc_init
+
+static list_entry_t kstack_cache;
+static int nr_kstack_cached = 0;
+
+// setup_kstack - get a kernel stack of KSTACKSIZE, from kstack_cache if possible
 static int
 setup_kstack(struct proc_struct *proc) {
-    struct Page *page = alloc_pages(KSTACKPAGE);
-    if (page != NULL) {
-        proc->kstack = (uintptr_t)page2kva(page);
-        return 0;
+    list_entry_t *le = NULL;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (!list_empty(&kstack_cache)) {
+            le = list_next(&kstack_cache);
+            list_del(le);
+            nr_kstack_cached --;
+        }
     }
-    return -E_NO_MEM;
+    local_intr_restore(intr_flag);
+
+    void *kstack = le;
+    if (kstack == NULL && (kstack = vmalloc(KSTACKSIZE)) == NULL) {
+        return -E_NO_MEM;
+    }
+    proc->kstack = (uintptr_t)kstack;
+    return 0;
 }
 
-// put_kstack - free the memory space of process kernel stack
+// put_kstack - give the kernel stack back to kstack_cache, or free it if the cache is full
 static void
 put_kstack(struct proc_struct *proc) {
-    free_pages(kva2page((void *)(proc->kstack)), KSTACKPAGE);
+    list_entry_t *le = (list_entry_t *)(proc->kstack);
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (nr_kstack_cached < KSTACK_CACHE_MAX) {
+            list_add(&kstack_cache, le);
+            nr_kstack_cached ++;
+            le = NULL;
+        }
+    }
+    local_intr_restore(intr_flag);
+
+    if (le != NULL) {
+        vfree(le);
+    }
+}
+
+// kstack_cache_init - set up kstack_cache with a few ready stacks
+static void
+kstack_cache_init(void) {
+    list_init(&kstack_cache);
+    int i;
+    for (i = 0; i < KSTACK_CACHE_PREFILL; i ++) {
+        void *kstack;
+        if ((kstack = vmalloc(KSTACKSIZE)) == NULL) {
+            break;
+        }
+        list_add(&kstack_cache, (list_entry_t *)kstack);
+        nr_kstack_cached ++;
+    }
 }
 
 // setup_pgdir - alloc one page as PDT
@@ -341,11 +462,11 @@ copy_mm(uint32_t clone_flags, struct proc_struct *proc) {
     if (setup_pgdir(mm) != 0) {
         goto bad_pgdir_cleanup_mm;
     }
-    lock_mm(oldmm);
+    lock_mm_read(oldmm);
     {
         ret = dup_mmap(mm, oldmm);
     }
-    unlock_mm(oldmm);
+    unlock_mm_read(oldmm);
 
     if (ret != 0) {
         goto bad_dup_cleanup_mmap;
@@ -441,7 +562,7 @@ do_fork(uint32_t clone_flags, uintptr_t stack, struct trapframe *tf) {
      * Some Useful MACROs, Functions and DEFINEs, you can use them in below implementation.
      * MACROs or Functions:
      *   alloc_proc:   create a proc struct and init fields (lab4:exercise1)
-     *   setup_kstack: alloc pages with size KSTACKPAGE as process kernel stack
+     *   setup_kstack: get a kernel stack of KSTACKSIZE for the process
      *   copy_mm:      process "proc" duplicate OR share process "current"'s mm according clone_flags
      *                 if clone_flags & CLONE_VM, then "share" ; else "duplicate"
      *   copy_thread:  setup the trapframe on the  process's kernel stack top and
@@ -469,10 +590,44 @@ do_fork(uint32_t clone_flags, uintptr_t stack, struct trapframe *tf) {
   *    update step 1: set child proc's parent to current process, make sure current process's wait_state is 0
   *    update step 5: insert proc_struct into hash_list && proc_list, set the relation links of process
     */
-  
+    if ((proc = alloc_proc()) == NULL) {
+        goto fork_out;
+    }
+    proc->parent = current;
+    assert(current->wait_state == 0);
+
+    if (setup_kstack(proc) != 0) {
+        goto bad_fork_cleanup_proc;
+    }
     if (copy_files(clone_flags, proc) != 0) { //for LAB8
         goto bad_fork_cleanup_kstack;
     }
+    if (copy_mm(clone_flags, proc) != 0) {
+        goto bad_fork_cleanup_fs;
+    }
+    copy_thread(proc, stack, tf);
+    // the child starts with the FP state of current, before it can run
+    fpu_fork(proc);
+
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        proc->pid = get_pid();
+        hash_proc(proc);
+        set_links(proc);
+        if (clone_flags & CLONE_THREAD) {
+            // a thread joins the thread group of its creator, nothing can fail after this
+            list_add_before(&(current->thread_group), &(proc->thread_group));
+        }
+    }
+    local_intr_restore(intr_flag);
+
+    if (clone_flags & CLONE_VFORK) {
+        // do_clone sleeps on it until the child execs or exits
+        proc->flags |= PF_VFORK;
+    }
+    wakeup_proc(proc);
+    ret = proc->pid;
    
 fork_out:
     return ret;
@@ -482,13 +637,230 @@ bad_fork_cleanup_fs:  //for LAB8
 bad_fork_cleanup_kstack:
     put_kstack(proc);
 bad_fork_cleanup_proc:
-    kfree(proc);
+    // not on the creator's thread group, or on any other list, and nobody waits for it
+    list_del_init(&(proc->thread_group));
+    proc->flags &= ~PF_VFORK;
+    kmem_cache_free(proc_cachep, proc);
     goto fork_out;
 }
 
+// vfork_wait - sleep until the vfork child @proc gives the mm back, by exec or exit
+static void
+vfork_wait(struct proc_struct *proc) {
+    bool intr_flag;
+    while (1) {
+        local_intr_save(intr_flag);
+        if (!(proc->flags & PF_VFORK)) {
+            local_intr_restore(intr_flag);
+            break;
+        }
+        current->state = PROC_SLEEPING;
+        current->wait_state = WT_VFORK;
+        local_intr_restore(intr_flag);
+        schedule();
+        if (current->flags & PF_EXITING) {
+            // the child keeps the mm, we only drop our reference
+            break;
+        }
+    }
+}
+
+// vfork_release - current, a vfork child, is done with the mm of its parent
+static void
+vfork_release(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (current->flags & PF_VFORK) {
+            current->flags &= ~PF_VFORK;
+            if (current->parent->wait_state == WT_VFORK) {
+                wakeup_proc(current->parent);
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+}
 
-// do_exit - called by sys_exit
-//   1. call exit_mmap & put_pgdir & mm_destroy to free the almost all memory space of process
+/* *
+ * do_clone - create a thread: with CLONE_VM and CLONE_FS the child shares
+ * the mm and the files of current, with CLONE_THREAD it also joins its
+ * thread group. The child returns 0 on the user stack @stack (the stack
+ * of current if 0) and, with CLONE_SETTLS, with tp = @tls.
+ *
+ * CLONE_VM | CLONE_VFORK is vfork: the child borrows the mm and the stack
+ * of current, which sleeps until the child execs or exits. Nothing is
+ * copied but the file table, so a fork that is followed by an exec costs
+ * no dup_mmap.
+ * */
+int
+do_clone(uint32_t clone_flags, uintptr_t stack, uintptr_t tls) {
+    if ((clone_flags & CLONE_THREAD) && !(clone_flags & CLONE_VM)) {
+        return -E_INVAL;
+    }
+    if ((clone_flags & CLONE_VFORK) && (!(clone_flags & CLONE_VM) || (clone_flags & CLONE_THREAD))) {
+        return -E_INVAL;
+    }
+    struct trapframe tf = *(current->tf);
+    if (clone_flags & CLONE_SETTLS) {
+        tf.gpr.tp = tls;
+    }
+    if (stack == 0) {
+        stack = tf.gpr.sp;
+    }
+    int ret = do_fork(clone_flags, stack, &tf);
+    if (ret > 0 && (clone_flags & CLONE_VFORK)) {
+        // the kernel is not preempted, the child cannot have exited and been reaped yet
+        struct proc_struct *proc = find_proc(ret);
+        assert(proc != NULL && proc->parent == current);
+        vfork_wait(proc);
+    }
+    return ret;
+}
+
+// __do_kill - make proc exit when it next returns to user mode, wake it up if its sleep can be interrupted
+static int
+__do_kill(struct proc_struct *proc) {
+    if (!(proc->flags & PF_EXITING)) {
+        proc->flags |= PF_EXITING;
+        if (proc->wait_state & WT_INTERRUPTED) {
+            wakeup_proc(proc);
+        }
+        return 0;
+    }
+    return -E_KILLED;
+}
+
+// thread_group_kill - kill the other threads in the thread group of current
+static void
+thread_group_kill(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *list = &(current->thread_group), *le = list;
+        while ((le = list_next(le)) != list) {
+            __do_kill(le2proc(le, thread_group));
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+/* *
+ * The reaper - a kernel thread that frees the mm (pages and page tables)
+ * and closes the files of exited processes, so that neither do_exit nor
+ * the do_wait of the parent pays for them. do_exit queues them and wakes
+ * the reaper, a normal process of the default (lowest) priority, which
+ * drains everything queued by the time it runs. While REAPER_MAX_PENDING
+ * mms wait, or before the reaper is started and after it stopped, do_exit
+ * tears down itself, so exits cannot hold back much memory.
+ * */
+#define REAPER_MAX_PENDING          16
+
+static struct proc_struct *reaperproc = NULL;
+static list_entry_t reap_mm_list, reap_files_list;
+static int nr_reap_mm = 0;
+static bool reaper_stopping = 0;
+
+// reap - free @mm and close the files of @filesp, their last users are gone; either may be NULL
+static void
+reap(struct mm_struct *mm, struct files_struct *filesp) {
+    if (mm != NULL) {
+        exit_mmap(mm);
+        put_pgdir(mm);
+        mm_destroy(mm);
+    }
+    if (filesp != NULL) {
+        files_destroy(filesp);
+    }
+}
+
+// reaper_defer - leave @mm and @filesp to the reaper, return 0 if it does not take them
+static bool
+reaper_defer(struct mm_struct *mm, struct files_struct *filesp) {
+    bool intr_flag, queued = 0;
+    local_intr_save(intr_flag);
+    if (reaperproc != NULL && !reaper_stopping && nr_reap_mm < REAPER_MAX_PENDING) {
+        if (mm != NULL) {
+            list_add_before(&reap_mm_list, &(mm->reap_link));
+            nr_reap_mm ++;
+        }
+        if (filesp != NULL) {
+            list_add_before(&reap_files_list, &(filesp->reap_link));
+        }
+        if (reaperproc->wait_state == WT_REAPER) {
+            wakeup_proc(reaperproc);
+        }
+        queued = 1;
+    }
+    local_intr_restore(intr_flag);
+    return queued;
+}
+
+static int
+reaper_main(void *arg) {
+    bool intr_flag;
+    list_entry_t *le;
+    while (1) {
+        struct mm_struct *mm = NULL;
+        struct files_struct *filesp = NULL;
+        local_intr_save(intr_flag);
+        if ((le = list_next(&reap_mm_list)) != &reap_mm_list) {
+            list_del(le);
+            mm = to_struct(le, struct mm_struct, reap_link);
+            nr_reap_mm --;
+        }
+        if ((le = list_next(&reap_files_list)) != &reap_files_list) {
+            list_del(le);
+            filesp = to_struct(le, struct files_struct, reap_link);
+        }
+        if (mm == NULL && filesp == NULL) {
+            if (reaper_stopping) {
+                local_intr_restore(intr_flag);
+                break;
+            }
+            current->state = PROC_SLEEPING;
+            current->wait_state = WT_REAPER;
+            local_intr_restore(intr_flag);
+            schedule();
+            continue;
+        }
+        local_intr_restore(intr_flag);
+        reap(mm, filesp);
+        cond_resched();
+    }
+    return 0;
+}
+
+// reaper_start - start the reaper, a child of init
+static void
+reaper_start(void) {
+    int pid;
+    list_init(&reap_mm_list);
+    list_init(&reap_files_list);
+    if ((pid = kernel_thread(reaper_main, NULL, 0)) <= 0) {
+        panic("create reaper failed.\n");
+    }
+    reaperproc = find_proc(pid);
+    set_proc_name(reaperproc, "reaper");
+}
+
+// reaper_stop - let the reaper finish what is queued and exit, then reap it
+static void
+reaper_stop(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        reaper_stopping = 1;
+        if (reaperproc->wait_state == WT_REAPER) {
+            wakeup_proc(reaperproc);
+        }
+    }
+    local_intr_restore(intr_flag);
+    assert(do_wait(reaperproc->pid, NULL) == 0);
+    reaperproc = NULL;
+}
+
+// do_exit - called by sys_exit_thread, and by do_exit_group
+//   1. leave the mm and the files to the reaper, or free them (exit_mmap & put_pgdir & mm_destroy, files_destroy)
 //   2. set process' state as PROC_ZOMBIE, then call wakeup_proc(parent) to ask parent reclaim itself.
 //   3. call scheduler to switch to other process
 int
@@ -501,14 +873,21 @@ do_exit(int error_code) {
     }
     struct mm_struct *mm = current->mm;
     if (mm != NULL) {
+        // it may be switched out while the page table is torn down, come back to boot_cr3
+        current->cr3 = boot_cr3;
         lcr3(boot_cr3);
-        if (mm_count_dec(mm) == 0) {
-            exit_mmap(mm);
-            put_pgdir(mm);
-            mm_destroy(mm);
+        struct files_struct *filesp = current->filesp;
+        if (mm_count_dec(mm) != 0) {
+            mm = NULL;
+        }
+        if (filesp != NULL && files_count_dec(filesp) != 0) {
+            filesp = NULL;
         }
         current->mm = NULL;
-        put_files(current);
+        current->filesp = NULL;
+        if (!reaper_defer(mm, filesp)) {
+            reap(mm, filesp);
+        }
     }
     current->state = PROC_ZOMBIE;
     current->exit_code = error_code;
@@ -516,6 +895,10 @@ do_exit(int error_code) {
     struct proc_struct *proc;
     local_intr_save(intr_flag);
     {
+        // the other threads of the group go on without us
+        list_del_init(&(current->thread_group));
+        vfork_release();
+        fpu_exit();
         proc = current->parent;
         if (proc->wait_state == WT_CHILD) {
             wakeup_proc(proc);
@@ -542,6 +925,13 @@ do_exit(int error_code) {
     panic("do_exit will not return!! %d.\n", current->pid);
 }
 
+// do_exit_group - called by sys_exit: the whole process exits, all the threads of its group
+int
+do_exit_group(int error_code) {
+    thread_group_kill();
+    return do_exit(error_code);
+}
+
 //load_icode_read is used by load_icode in LAB8
 static int
 load_icode_read(int fd, void *buf, size_t len, off_t offset) {
@@ -584,7 +974,163 @@ load_icode(int fd, int argc, char **kargv) {
      * (7) setup trapframe for user environment
      * (8) if up steps failed, you should cleanup the env.
      */
-    
+    assert(argc >= 0 && argc <= EXEC_MAX_ARG_NUM);
+
+    if (current->mm != NULL) {
+        panic("load_icode: current->mm must be empty.\n");
+    }
+
+    int ret = -E_NO_MEM;
+    struct mm_struct *mm;
+    if ((mm = mm_create()) == NULL) {
+        goto bad_mm;
+    }
+    if (setup_pgdir(mm) != 0) {
+        goto bad_pgdir_cleanup_mm;
+    }
+
+    struct Page *page;
+    struct elfhdr __elf, *elf = &__elf;
+    if ((ret = load_icode_read(fd, elf, sizeof(struct elfhdr), 0)) != 0) {
+        goto bad_elf_cleanup_pgdir;
+    }
+    if (elf->e_magic != ELF_MAGIC) {
+        ret = -E_INVAL_ELF;
+        goto bad_elf_cleanup_pgdir;
+    }
+
+    struct proghdr __ph, *ph = &__ph;
+    uint32_t vm_flags, perm, phnum;
+    for (phnum = 0; phnum < elf->e_phnum; phnum ++) {
+        off_t phoff = elf->e_phoff + sizeof(struct proghdr) * phnum;
+        if ((ret = load_icode_read(fd, ph, sizeof(struct proghdr), phoff)) != 0) {
+            goto bad_cleanup_mmap;
+        }
+        if (ph->p_type != ELF_PT_LOAD) {
+            continue;
+        }
+        if (ph->p_filesz > ph->p_memsz) {
+            ret = -E_INVAL_ELF;
+            goto bad_cleanup_mmap;
+        }
+        if (ph->p_memsz == 0) {
+            continue;
+        }
+        vm_flags = 0, perm = PTE_U | PTE_V;
+        if (ph->p_flags & ELF_PF_X) vm_flags |= VM_EXEC;
+        if (ph->p_flags & ELF_PF_W) vm_flags |= VM_WRITE;
+        if (ph->p_flags & ELF_PF_R) vm_flags |= VM_READ;
+        if (vm_flags & VM_READ) perm |= PTE_R;
+        if (vm_flags & VM_WRITE) perm |= (PTE_W | PTE_R);
+        if (vm_flags & VM_EXEC) perm |= PTE_X;
+        if ((ret = mm_map(mm, ph->p_va, ph->p_memsz, vm_flags, NULL)) != 0) {
+            goto bad_cleanup_mmap;
+        }
+        off_t offset = ph->p_offset;
+        size_t off, size;
+        uintptr_t start = ph->p_va, end, la = ROUNDDOWN(start, PGSIZE);
+
+        ret = -E_NO_MEM;
+
+        // the TEXT/DATA part, read from the file
+        end = ph->p_va + ph->p_filesz;
+        while (start < end) {
+            if ((page = pgdir_alloc_page(mm->pgdir, la, perm)) == NULL) {
+                ret = -E_NO_MEM;
+                goto bad_cleanup_mmap;
+            }
+            off = start - la, size = PGSIZE - off, la += PGSIZE;
+            if (end < la) {
+                size -= la - end;
+            }
+            if ((ret = load_icode_read(fd, page2kva(page) + off, size, offset)) != 0) {
+                goto bad_cleanup_mmap;
+            }
+            start += size, offset += size;
+        }
+
+        // the BSS part: the rest of the last page read, then zeroed pages
+        end = ph->p_va + ph->p_memsz;
+        if (start < la) {
+            if (start == end) {
+                continue;
+            }
+            off = start + PGSIZE - la, size = PGSIZE - off;
+            if (end < la) {
+                size -= la - end;
+            }
+            memset(page2kva(page) + off, 0, size);
+            start += size;
+            assert((end < la && start == end) || (end >= la && start == la));
+        }
+        while (start < end) {
+            if ((page = pgdir_alloc_page(mm->pgdir, la, perm)) == NULL) {
+                ret = -E_NO_MEM;
+                goto bad_cleanup_mmap;
+            }
+            off = start - la, size = PGSIZE - off, la += PGSIZE;
+            if (end < la) {
+                size -= la - end;
+            }
+            memset(page2kva(page) + off, 0, size);
+            start += size;
+        }
+    }
+    sysfile_close(fd);
+
+    vm_flags = VM_READ | VM_WRITE | VM_STACK;
+    if ((ret = mm_map(mm, USTACKTOP - USTACKSIZE, USTACKSIZE, vm_flags, NULL)) != 0) {
+        goto bad_cleanup_mmap;
+    }
+    // the top pages of the stack, where the arguments go; the rest is faulted in
+    int i;
+    for (i = 1; i <= 4; i ++) {
+        if (pgdir_alloc_page(mm->pgdir, USTACKTOP - i * PGSIZE, PTE_USER) == NULL) {
+            ret = -E_NO_MEM;
+            goto bad_cleanup_mmap;
+        }
+    }
+
+    mm_count_inc(mm);
+    current->mm = mm;
+    current->cr3 = PADDR(mm->pgdir);
+    lcr3(PADDR(mm->pgdir));
+
+    // the argument strings at the top of the stack, the argv array below them
+    uint32_t argv_size = 0;
+    for (i = 0; i < argc; i ++) {
+        argv_size += strnlen(kargv[i], EXEC_MAX_ARG_LEN + 1) + 1;
+    }
+    uintptr_t stacktop = USTACKTOP - ROUNDUP(argv_size, sizeof(long));
+    char **uargv = (char **)(stacktop - argc * sizeof(char *));
+    argv_size = 0;
+    for (i = 0; i < argc; i ++) {
+        uargv[i] = strcpy((char *)(stacktop + argv_size), kargv[i]);
+        argv_size += strnlen(kargv[i], EXEC_MAX_ARG_LEN + 1) + 1;
+    }
+    // keep sp 16-byte aligned as the calling convention wants
+    stacktop = ROUNDDOWN((uintptr_t)uargv, 16);
+
+    struct trapframe *tf = current->tf;
+    uintptr_t sstatus = tf->status;
+    memset(tf, 0, sizeof(struct trapframe));
+    tf->gpr.sp = stacktop;
+    tf->gpr.a0 = argc;
+    tf->gpr.a1 = (uintptr_t)uargv;
+    tf->epc = elf->e_entry;
+    // sret goes to user mode, with interrupts on
+    tf->status = (sstatus & ~SSTATUS_SPP) | SSTATUS_SPIE;
+    ret = 0;
+out:
+    return ret;
+bad_cleanup_mmap:
+    exit_mmap(mm);
+bad_elf_cleanup_pgdir:
+    put_pgdir(mm);
+bad_pgdir_cleanup_mm:
+    mm_destroy(mm);
+bad_mm:
+    goto out;
 }
 
 // this function isn't very correct in LAB8
@@ -639,22 +1185,25 @@ do_execve(const char *name, int argc, const char **argv) {
 
     int ret = -E_INVAL;
 
-    lock_mm(mm);
+    lock_mm_read(mm);
     if (name == NULL) {
         snprintf(local_name, sizeof(local_name), "<null> %d", current->pid);
     }
     else {
         if (!copy_string(mm, local_name, name, sizeof(local_name))) {
-            unlock_mm(mm);
+            unlock_mm_read(mm);
             return ret;
         }
     }
     if ((ret = copy_kargv(mm, argc, kargv, argv)) != 0) {
-        unlock_mm(mm);
+        unlock_mm_read(mm);
         return ret;
     }
     path = argv[0];
-    unlock_mm(mm);
+    unlock_mm_read(mm);
+    // the other threads would run on in the old image, with our files closed
+    thread_group_kill();
+    list_del_init(&(current->thread_group));
     files_closeall(current->filesp);
 
     /* sysfile_open will check the first argument path, thus we have to use a user-space pointer, and argv[0] may be incorrect */
@@ -663,6 +1212,8 @@ do_execve(const char *name, int argc, const char **argv) {
         goto execve_exit;
     }
     if (mm != NULL) {
+        // it may be switched out while the page table is torn down, come back to boot_cr3
+        current->cr3 = boot_cr3;
         lcr3(boot_cr3);
         if (mm_count_dec(mm) == 0) {
             exit_mmap(mm);
@@ -671,10 +1222,13 @@ do_execve(const char *name, int argc, const char **argv) {
         }
         current->mm = NULL;
     }
+    // a vfork parent gets its mm back, it was not touched after the arguments were copied
+    vfork_release();
     ret= -E_NO_MEM;;
     if ((ret = load_icode(fd, argc, kargv)) != 0) {
         goto execve_exit;
     }
+    fpu_exec();
     put_kargv(argc, kargv);
     set_proc_name(current, local_name);
     return 0;
@@ -688,10 +1242,25 @@ execve_exit:
 // do_yield - ask the scheduler to reschedule
 int
 do_yield(void) {
+    // give up the rest of the time slice, a real-time proc goes to the tail of its queue
+    current->time_slice = 0;
     current->need_resched = 1;
     return 0;
 }
 
+// proc_acct_add - add the accounting @from to @to
+static void
+proc_acct_add(struct proc_acct *to, struct proc_acct *from) {
+    to->utime += from->utime;
+    to->stime += from->stime;
+    to->rq_delay += from->rq_delay;
+    if (from->rq_delay_max > to->rq_delay_max) {
+        to->rq_delay_max = from->rq_delay_max;
+    }
+    to->nvcsw += from->nvcsw;
+    to->nivcsw += from->nivcsw;
+}
+
 // do_wait - wait one OR any children with PROC_ZOMBIE state, and free memory space of kernel stack
 //         - proc struct of this child.
 // NOTE: only after do_wait function, all resources of the child proces are free.
@@ -744,6 +1313,8 @@ found:
     if (code_store != NULL) {
         *code_store = proc->exit_code;
     }
+    proc_acct_add(&(current->cacct), &(proc->acct));
+    proc_acct_add(&(current->cacct), &(proc->cacct));
     local_intr_save(intr_flag);
     {
         unhash_proc(proc);
@@ -751,7 +1322,7 @@ found:
     }
     local_intr_restore(intr_flag);
     put_kstack(proc);
-    kfree(proc);
+    kmem_cache_free(proc_cachep, proc);
     return 0;
 }
 // do_kill - kill process with pid by set this process's flags with PF_EXITING
@@ -759,14 +1330,7 @@ int
 do_kill(int pid) {
     struct proc_struct *proc;
     if ((proc = find_proc(pid)) != NULL) {
-        if (!(proc->flags & PF_EXITING)) {
-            proc->flags |= PF_EXITING;
-            if (proc->wait_state & WT_INTERRUPTED) {
-                wakeup_proc(proc);
-            }
-            return 0;
-        }
-        return -E_KILLED;
+        return __do_kill(proc);
     }
     return -E_INVAL;
 }
@@ -832,16 +1396,25 @@ init_main(void *arg) {
     size_t nr_free_pages_store = nr_free_pages();
     size_t kernel_allocated_store = kallocated();
 
+    check_mutex();
+    check_rwsem();
+#ifdef CHECK_SYNC
+    // the philosophers and producer/consumer, with the Hoare/Mesa switch counts
+    extern void check_sync(void);
+    check_sync();
+#endif
+
     int pid = kernel_thread(user_main, NULL, 0);
     if (pid <= 0) {
         panic("create user_main failed.\n");
     }
-    extern void check_sync(void);
-    //check_sync();                // check philosopher sync problem
+    reaper_start();
 
-    while (do_wait(0, NULL) == 0) {
+    // the reaper is the last child once the user processes are gone
+    while ((initproc->cptr != reaperproc || reaperproc->optr != NULL) && do_wait(0, NULL) == 0) {
         schedule();
     }
+    reaper_stop();
     
     fs_cleanup();
     
@@ -861,6 +1434,11 @@ void
 proc_init(void) {
     int i;
 
+    if ((proc_cachep = kmem_cache_create("proc_struct", sizeof(struct proc_struct), 0, NULL)) == NULL) {
+        panic("cannot create proc_struct cache.\n");
+    }
+    kstack_cache_init();
+
     list_init(&proc_list);
     for (i = 0; i < HASH_LIST_SIZE; i ++) {
         list_init(hash_list + i);
@@ -874,6 +1452,8 @@ proc_init(void) {
     idleproc->state = PROC_RUNNABLE;
     idleproc->kstack = (uintptr_t)bootstack;
     idleproc->need_resched = 1;
+    // idle switches in cpu_idle only, not in the middle of kern_init
+    idleproc->preempt_count ++;
 	
     
     if ((idleproc->filesp = files_create()) == NULL) {
@@ -885,6 +1465,7 @@ proc_init(void) {
     nr_process ++;
 
     current = idleproc;
+    mycpu()->kstack_base = idleproc->kstack;
 
     int pid = kernel_thread(init_main, NULL, 0);
     if (pid <= 0) {
@@ -898,6 +1479,75 @@ proc_init(void) {
     assert(initproc != NULL && initproc->pid == 1);
 }
 
+/* *
+ * idleproc_create - create the idle process of the secondary cpu @id, it
+ * runs cpu_idle on its own kstack. It shares the files of the first idle
+ * process and is not counted in nr_process.
+ * */
+struct proc_struct *
+idleproc_create(int id) {
+    struct proc_struct *proc;
+    if ((proc = alloc_proc()) == NULL) {
+        return NULL;
+    }
+    if (setup_kstack(proc) != 0) {
+        kmem_cache_free(proc_cachep, proc);
+        return NULL;
+    }
+    proc->pid = 0;
+    proc->state = PROC_RUNNABLE;
+    proc->need_resched = 1;
+    proc->preempt_count ++;
+    proc->filesp = cpus[0].idle->filesp;
+    files_count_inc(proc->filesp);
+
+    char name[PROC_NAME_LEN + 1];
+    snprintf(name, sizeof(name), "idle/%d", id);
+    set_proc_name(proc, name);
+    return proc;
+}
+
+// idleproc_destroy - free an idle process made by idleproc_create that never ran
+void
+idleproc_destroy(struct proc_struct *proc) {
+    files_count_dec(proc->filesp);
+    put_kstack(proc);
+    kmem_cache_free(proc_cachep, proc);
+}
+
+#define IDLE_MAX_TICKS              1000    // the longest an idle cpu stops the tick
+
+/* *
+ * idle_wait - stop the cpu with wfi until the next interrupt. Unless some
+ * process waits for console input, which is only polled on ticks, the
+ * periodic tick is stopped and the timer is armed for the first tick that
+ * has timers to run; the timer interrupt catches up the skipped ticks.
+ * wfi also returns for an interrupt that is pending while they are
+ * disabled, so need_resched cannot be set between the check and the wfi.
+ * Only the boot cpu runs the timers and stops its tick; the others keep
+ * theirs to look for work to steal. The kernel lock is free during wfi.
+ * */
+static void
+idle_wait(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (!current->need_resched) {
+            if (cpu_is_boot() && !dev_stdin_waiting()) {
+                clock_stop_tick(timer_idle_ticks(IDLE_MAX_TICKS));
+            }
+            unlock_kernel();
+            wfi();
+            lock_kernel();
+            if (cpu_is_boot()) {
+                // an IPI may have woken us up with the tick still stopped
+                clock_set_next_event();
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
 // cpu_idle - at the end of kern_init, the first kernel thread idleproc will do below works
 void
 cpu_idle(void) {
@@ -905,6 +1555,9 @@ cpu_idle(void) {
         if (current->need_resched) {
             schedule();
         }
+        else {
+            idle_wait();
+        }
     }
 }
 //FOR LAB6, set the process's priority (bigger value will get more CPU time)
@@ -912,10 +1565,56 @@ void
 lab6_set_priority(uint32_t priority)
 {
     cprintf("set priority to %d\n", priority);
-    if (priority == 0)
-        current->lab6_priority = 1;
-    else current->lab6_priority = priority;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        current->base_priority = current->lab6_priority = (priority == 0) ? 1 : priority;
+        mutex_pi_update(current);
+    }
+    local_intr_restore(intr_flag);
+}
+/* *
+ * do_nanosleep - sleep for @ns nanoseconds on an hrtimer, not rounded to
+ * ticks. If the process is woken up early (killed), return -E_KILLED and
+ * store the time left in *@remain_store.
+ * */
+int
+do_nanosleep(uint64_t ns, uint64_t *remain_store) {
+    *remain_store = 0;
+    if (ns == 0) {
+        return 0;
+    }
+    struct hrtimer __timer, *timer = &__timer;
+    uint64_t expires = get_cycles() + ns_to_cycles(ns);
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    hrtimer_init(timer, current, expires);
+    current->state = PROC_SLEEPING;
+    current->wait_state = WT_TIMER;
+    hrtimer_add(timer);
+    local_intr_restore(intr_flag);
+
+    schedule();
+
+    hrtimer_del(timer);
+    uint64_t now = get_cycles();
+    if (now < expires) {
+        *remain_store = (expires - now) * (NSEC_PER_SEC / CLOCK_FREQ);
+        return -E_KILLED;
+    }
+    return 0;
 }
+
+// do_sched_setscheduler - set the scheduling policy of process @pid, 0 for current
+int
+do_sched_setscheduler(int pid, int policy, int priority) {
+    struct proc_struct *proc = current;
+    if (pid != 0 && (proc = find_proc(pid)) == NULL) {
+        return -E_INVAL;
+    }
+    return sched_setscheduler(proc, policy, priority);
+}
+
 // do_sleep - set current process state to sleep and add timer with "time"
 //          - then call scheduler. if process run again, delete timer first.
 int
@@ -936,3 +1635,71 @@ do_sleep(unsigned int time) {
     del_timer(timer);
     return 0;
 }
+
+static void
+acct_to_rusage(struct proc_acct *acct, struct rusage *usage) {
+    ns_to_timespec(cycles_to_ns(acct->utime), &(usage->ru_utime));
+    ns_to_timespec(cycles_to_ns(acct->stime), &(usage->ru_stime));
+    ns_to_timespec(cycles_to_ns(acct->rq_delay), &(usage->ru_rqdelay));
+    ns_to_timespec(cycles_to_ns(acct->rq_delay_max), &(usage->ru_rqdelay_max));
+    usage->ru_nvcsw = acct->nvcsw;
+    usage->ru_nivcsw = acct->nivcsw;
+}
+
+// do_getrusage - the cpu accounting of current (RUSAGE_SELF) or of its reaped children (RUSAGE_CHILDREN)
+int
+do_getrusage(int who, struct rusage *usage) {
+    if (who == RUSAGE_SELF) {
+        // charge the time in this system call so far
+        sched_acct_system();
+        acct_to_rusage(&(current->acct), usage);
+    }
+    else if (who == RUSAGE_CHILDREN) {
+        acct_to_rusage(&(current->cacct), usage);
+    }
+    else {
+        return -E_INVAL;
+    }
+    return 0;
+}
+
+static const char *
+proc_state_name(struct proc_struct *proc) {
+    static const char *names[] = {
+        [PROC_UNINIT]   "U",
+        [PROC_SLEEPING] "S",
+        [PROC_RUNNABLE] "R",
+        [PROC_ZOMBIE]   "Z",
+    };
+    return names[proc->state];
+}
+
+static inline unsigned int
+cycles_to_ms(uint64_t cycles) {
+    return cycles_to_ns(cycles) / NSEC_PER_MSEC;
+}
+
+// proc_print_top - the cpu accounting of every process and the idle time of every cpu
+void
+proc_print_top(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        cprintf("  pid name             st cpu  user(ms)   sys(ms) rqwait(ms) maxwait(us)   vcsw  ivcsw\n");
+        list_entry_t *list = &proc_list, *le = list;
+        while ((le = list_next(le)) != list) {
+            struct proc_struct *proc = le2proc(le, list_link);
+            cprintf("%5d %-16s %2s %3d %9d %9d %10d %11d %6d %6d\n", proc->pid, proc->name,
+                    proc_state_name(proc), (proc->rq != NULL) ? rq_cpu(proc->rq)->id : -1,
+                    cycles_to_ms(proc->acct.utime), cycles_to_ms(proc->acct.stime),
+                    cycles_to_ms(proc->acct.rq_delay), (unsigned int)(cycles_to_ns(proc->acct.rq_delay_max) / NSEC_PER_USEC),
+                    (unsigned int)proc->acct.nvcsw, (unsigned int)proc->acct.nivcsw);
+        }
+        int i;
+        for (i = 0; i < ncpu; i ++) {
+            cprintf("cpu%d: idle %d ms\n", i, cycles_to_ms(cpus[i].idle->acct.stime));
+        }
+    }
+    local_intr_restore(intr_flag);
+    sched_print_rq_delay();
+}
@@ -6,6 +6,18 @@
 #include <trap.h>
 #include <memlayout.h>
 #include <skew_heap.h>
+#include <cpu.h>
+#include <fpu.h>
+
+// the cpu accounting of a process, in rdtime cycles
+struct proc_acct {
+    uint64_t utime;                             // time in user mode
+    uint64_t stime;                             // time in the kernel
+    uint64_t rq_delay;                          // time runnable, waiting on a run queue
+    uint64_t rq_delay_max;                      // the longest of those waits
+    uint64_t nvcsw;                             // switched out because it slept
+    uint64_t nivcsw;                            // switched out while still runnable
+};
 
 // process's state in his life cycle
 enum proc_state {
@@ -39,6 +51,7 @@ struct context {
 extern list_entry_t proc_list;
 
 struct inode;
+struct mutex;
 
 struct proc_struct {
     enum proc_state state;                      // Process state
@@ -65,22 +78,54 @@ struct proc_struct {
     uint32_t lab6_stride;                       // FOR LAB6 ONLY: the current stride of the process
     uint32_t lab6_priority;                     // FOR LAB6 ONLY: the priority of process, set by lab6_set_priority(uint32_t)
     struct files_struct *filesp;                // the file related info(pwd, files_count, files_array, fs_semaphore) of process
+    int mlfq_level;                             // MLFQ: the priority level, 0 is the highest
+    int mlfq_allot;                             // MLFQ: ticks left before the process is demoted
+    unsigned int mlfq_epoch;                    // MLFQ: the boost epoch of its run queue when it was last queued
+    uint64_t cfs_vruntime;                      // CFS: weighted cpu time consumed, in cycles
+    uint64_t cfs_exec_start;                    // CFS: when the process got the cpu, 0 if not running
+    int sched_policy;                           // SCHED_NORMAL, SCHED_FIFO or SCHED_RR
+    int rt_priority;                            // real-time priority, 0 for SCHED_NORMAL
+    int base_policy;                            // the policy it was given, sched_policy may be inherited
+    int base_rt_priority;                       // the rt_priority it was given
+    uint32_t base_priority;                     // the lab6_priority it was given
+    list_entry_t pi_mutexes;                    // the kernel mutexes it holds, their waiters lend it priority
+    struct mutex *pi_blocked_on;                // the kernel mutex it waits for
+    list_entry_t thread_group;                  // the other threads sharing the mm, made by CLONE_THREAD
+    struct fpu_state fpu;                       // the FP registers, when they are not in the cpu
+    int fpu_cpu;                                // the cpu whose FP registers it loaded last, -1 if none
+    bool fpu_used;                              // it has used FP, fpu is valid
+    struct proc_acct acct;                      // cpu accounting
+    struct proc_acct cacct;                     // the accounting of its reaped children, and theirs
+    uint64_t acct_stamp;                        // when utime or stime was last charged
+    uint64_t rq_stamp;                          // when it was put on a run queue
+    int preempt_count;                          // 0 in a preemptible kernel section, see preempt.h
 };
 
 #define PF_EXITING                  0x00000001      // getting shutdown
+#define PF_VFORK                    0x00000002      // made by CLONE_VFORK, its parent waits for it to exec or exit
 
 #define WT_CHILD                    (0x00000001 | WT_INTERRUPTED)
 #define WT_INTERRUPTED               0x80000000                    // the wait state could be interrupted
 
 #define WT_CHILD                    (0x00000001 | WT_INTERRUPTED)  // wait child process
 #define WT_KSEM                      0x00000100                    // wait kernel semaphore
+#define WT_KMUTEX                    0x00000200                    // wait kernel mutex
+#define WT_KRWSEM_READ               0x00000400                    // wait to read a kernel rwsem
+#define WT_KRWSEM_WRITE              0x00000800                    // wait to write a kernel rwsem
+#define WT_REAPER                    0x00001000                    // the reaper waits for work
 #define WT_TIMER                    (0x00000002 | WT_INTERRUPTED)  // wait timer
 #define WT_KBD                      (0x00000004 | WT_INTERRUPTED)  // wait the input of keyboard
+#define WT_VFORK                    (0x00000008 | WT_INTERRUPTED)  // wait a vfork child to exec or exit
+#define WT_FUTEX                    (0x00000010 | WT_INTERRUPTED)  // wait on a futex
 
 #define le2proc(le, member)         \
     to_struct((le), struct proc_struct, member)
 
-extern struct proc_struct *idleproc, *initproc, *current;
+extern struct proc_struct *initproc;
+
+// the running process and the idle process of this cpu
+#define current                     (mycpu()->proc)
+#define idleproc                    (mycpu()->idle)
 
 void proc_init(void);
 void proc_run(struct proc_struct *proc);
@@ -89,6 +134,8 @@ int kernel_thread(int (*fn)(void *), void *arg, uint32_t clone_flags);
 char *set_proc_name(struct proc_struct *proc, const char *name);
 char *get_proc_name(struct proc_struct *proc);
 void cpu_idle(void) __attribute__((noreturn));
+struct proc_struct *idleproc_create(int id);
+void idleproc_destroy(struct proc_struct *proc);
 
 //FOR LAB6, set the process's priority (bigger value will get more CPU time)
 void lab6_set_priority(uint32_t priority);
@@ -97,10 +144,18 @@ void lab6_set_priority(uint32_t priority);
 struct proc_struct *find_proc(int pid);
 int do_fork(uint32_t clone_flags, uintptr_t stack, struct trapframe *tf);
 int do_exit(int error_code);
+int do_exit_group(int error_code);
+int do_clone(uint32_t clone_flags, uintptr_t stack, uintptr_t tls);
 int do_yield(void);
 int do_execve(const char *name, int argc, const char **argv);
 int do_wait(int pid, int *code_store);
 int do_kill(int pid);
 int do_sleep(unsigned int time);
+int do_nanosleep(uint64_t ns, uint64_t *remain_store);
+int do_sched_setscheduler(int pid, int policy, int priority);
+
+struct rusage;
+int do_getrusage(int who, struct rusage *usage);
+void proc_print_top(void);
 #endif /* !__KERN_PROCESS_PROC_H__ */
 
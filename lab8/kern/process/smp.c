@@ -0,0 +1,178 @@
+#include <defs.h>
+#include <riscv.h>
+#include <sbi.h>
+#include <atomic.h>
+#include <mmu.h>
+#include <memlayout.h>
+#include <pmm.h>
+#include <spinlock.h>
+#include <stdio.h>
+#include <assert.h>
+#include <trap.h>
+#include <clock.h>
+#include <intr.h>
+#include <sched.h>
+#include <proc.h>
+#include <cpu.h>
+
+/* *
+ * Symmetric multiprocessing
+ *
+ * The boot hart is cpus[0]. smp_init starts the other harts through the
+ * SBI HSM extension at kern_entry_secondary, each with an idle process of
+ * its own, and they join the scheduler in secondary_init. Every cpu has
+ * its own current process and run queue; tp points to its struct cpu.
+ *
+ * The kernel is not made reentrant: kernel code runs under one big lock.
+ * A cpu takes it when it traps from user mode and drops it on the way
+ * back, in forkret for a new user process, and around wfi when idle, so
+ * user code runs in parallel on all cpus while the kernel runs on one at
+ * a time. The lock is held across switch_to.
+ *
+ * Only the boot cpu advances ticks, the timer wheel and the hrtimers; the
+ * others keep a periodic tick for their running process. Other cpus are
+ * poked with software interrupts (IPIs): to reschedule an idle cpu that
+ * was given a process, or to make the boot cpu re-arm its timer.
+ * */
+
+struct cpu cpus[NCPU];
+int ncpu = 1;
+
+static char emerg_stacks[NCPU][EMERG_STACK_SIZE] __attribute__((aligned(16)));
+
+static spinlock_t kernel_lock;
+// the id of the cpu holding kernel_lock, -1 if none
+static volatile int kernel_lock_holder = -1;
+
+void
+lock_kernel(void) {
+    assert(kernel_lock_holder != mycpu()->id);
+    spin_lock(&kernel_lock);
+    kernel_lock_holder = mycpu()->id;
+}
+
+void
+unlock_kernel(void) {
+    assert(kernel_lock_holder == mycpu()->id);
+    kernel_lock_holder = -1;
+    spin_unlock(&kernel_lock);
+}
+
+// kernel_locked - this cpu holds the kernel lock
+bool
+kernel_locked(void) {
+    return kernel_lock_holder == mycpu()->id;
+}
+
+// smp_boot_cpu - the boot hart becomes cpus[0], before anything uses current
+void
+smp_boot_cpu(uintptr_t hartid) {
+    struct cpu *cpu = cpus;
+    cpu->id = 0;
+    cpu->hartid = hartid;
+    cpu->online = 1;
+    cpu->emerg_stack = (uintptr_t)(emerg_stacks[cpu->id] + EMERG_STACK_SIZE);
+    __asm__ __volatile__("mv tp, %0" : : "r"(cpu));
+    spinlock_init(&kernel_lock);
+    lock_kernel();
+}
+
+// secondary_init - the C entry of a secondary hart, on its idle process
+void __attribute__((noreturn))
+secondary_init(void) {
+    struct cpu *cpu = mycpu();
+    idt_init();
+    cpu->online = 1;
+
+    lock_kernel();
+    cprintf("cpu%d: hart %d online\n", cpu->id, (int)cpu->hartid);
+    set_csr(sie, MIP_SSIP);
+    clock_init_cpu();
+    intr_enable();
+    cpu_idle();
+}
+
+#define SMP_BOOT_TIMEOUT            (CLOCK_FREQ / 10)
+
+// smp_init - start the other harts, called by the boot cpu holding the kernel lock
+void
+smp_init(void) {
+    extern char kern_entry_secondary[];
+    uintptr_t hartid;
+
+    set_csr(sie, MIP_SSIP);
+    for (hartid = 0; hartid < MAX_HARTID && ncpu < NCPU; hartid ++) {
+        if (hartid == cpus[0].hartid) {
+            continue;
+        }
+        struct cpu *cpu = cpus + ncpu;
+        cpu->id = ncpu;
+        cpu->hartid = hartid;
+        sched_rq_init(&(cpu->rq));
+        if ((cpu->idle = idleproc_create(cpu->id)) == NULL) {
+            warn("cannot alloc the idle proc of cpu%d.\n", cpu->id);
+            break;
+        }
+        cpu->proc = cpu->idle;
+        cpu->kstack = cpu->idle->kstack + KSTACKSIZE;
+        cpu->kstack_base = cpu->idle->kstack;
+        cpu->emerg_stack = (uintptr_t)(emerg_stacks[cpu->id] + EMERG_STACK_SIZE);
+
+        // no such hart, or an SBI without HSM
+        if (sbi_hart_start(hartid, PADDR(kern_entry_secondary), (uintptr_t)cpu) != 0) {
+            idleproc_destroy(cpu->idle);
+            cpu->idle = cpu->proc = NULL;
+            continue;
+        }
+        uint64_t start = get_cycles();
+        while (!cpu->online && get_cycles() - start < SMP_BOOT_TIMEOUT)
+            /* nothing */ ;
+        if (!cpu->online) {
+            panic("hart %d started but did not come up.\n", (int)hartid);
+        }
+        ncpu ++;
+    }
+    cprintf("smp: %d cpu(s) online\n", ncpu);
+}
+
+// smp_send_ipi - post @ipi to @cpu and interrupt it
+void
+smp_send_ipi(struct cpu *cpu, int ipi) {
+    assert(cpu->online);
+    set_bit(ipi, &(cpu->ipi_pending));
+    unsigned long hart_mask = 1UL << cpu->hartid;
+    sbi_send_ipi(&hart_mask);
+}
+
+// smp_ipi_handler - the supervisor software interrupt: handle the IPIs posted to this cpu
+void
+smp_ipi_handler(void) {
+    struct cpu *cpu = mycpu();
+    clear_csr(sip, SIP_SSIP);
+    if (test_and_clear_bit(IPI_RESCHED, &(cpu->ipi_pending))) {
+        cpu->proc->need_resched = 1;
+    }
+    if (test_and_clear_bit(IPI_TIMER, &(cpu->ipi_pending))) {
+        clock_set_next_event();
+    }
+}
+
+/* *
+ * smp_tlb_shootdown - after the mapping of @la was changed and flushed
+ * here, flush it on the other online cpus too. SBI does the remote
+ * sfence.vma, the other cpus do not take an interrupt for it.
+ * */
+void
+smp_tlb_shootdown(uintptr_t la) {
+    unsigned long hart_mask = 0;
+    int i;
+    for (i = 0; i < ncpu; i ++) {
+        if (cpus + i != mycpu() && cpus[i].online) {
+            hart_mask |= 1UL << cpus[i].hartid;
+        }
+    }
+    if (hart_mask != 0) {
+        sbi_remote_sfence_vma(&hart_mask, la, PGSIZE);
+    }
+}
+
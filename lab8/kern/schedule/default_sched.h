@@ -4,6 +4,10 @@
 #include <sched.h>
 
 extern struct sched_class default_sched_class;
+extern struct sched_class rr_sched_class;
+extern struct sched_class mlfq_sched_class;
+extern struct sched_class cfs_sched_class;
+extern struct sched_class rt_sched_class;
 
 #endif /* !__KERN_SCHEDULE_SCHED_RR_H__ */
 
@@ -0,0 +1,166 @@
+#include <defs.h>
+#include <sync.h>
+#include <proc.h>
+#include <sched.h>
+#include <clock.h>
+#include <stdio.h>
+#include <assert.h>
+#include <kmalloc.h>
+#include <skew_heap.h>
+#include <hrtimer.h>
+
+/* *
+ * High-resolution timers
+ *
+ * Pending hrtimers are kept in a skew heap ordered by deadline. The
+ * earliest deadline is handed to the clock driver, which arms the SBI
+ * timer for whichever comes first, that deadline or the next tick. The
+ * timer interrupt then calls hrtimer_run to expire every hrtimer whose
+ * deadline has passed, so an hrtimer fires within the interrupt latency
+ * of its deadline instead of on the next 10ms tick.
+ * */
+
+static skew_heap_entry_t *hrtimer_heap;
+
+static void check_hrtimer(void);
+
+static int
+hrtimer_comp_f(void *a, void *b) {
+    struct hrtimer *p = le2hrtimer(a, hrtimer_node);
+    struct hrtimer *q = le2hrtimer(b, hrtimer_node);
+    if (p->expires > q->expires) return 1;
+    else if (p->expires == q->expires) return 0;
+    else return -1;
+}
+
+// hrtimer_reprogram - tell the clock driver the earliest deadline
+static void
+hrtimer_reprogram(void) {
+    uint64_t expires = (uint64_t)-1;
+    if (hrtimer_heap != NULL) {
+        expires = le2hrtimer(hrtimer_heap, hrtimer_node)->expires;
+    }
+    clock_set_hrtimer_event(expires);
+}
+
+void
+hrtimers_init(void) {
+    hrtimer_heap = NULL;
+    check_hrtimer();
+}
+
+void
+hrtimer_add(struct hrtimer *timer) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        assert(!timer->pending && (timer->proc != NULL || timer->func != NULL));
+        skew_heap_init(&(timer->hrtimer_node));
+        hrtimer_heap = skew_heap_insert(hrtimer_heap, &(timer->hrtimer_node), hrtimer_comp_f);
+        timer->pending = 1;
+        if (hrtimer_heap == &(timer->hrtimer_node)) {
+            hrtimer_reprogram();
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+void
+hrtimer_del(struct hrtimer *timer) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (timer->pending) {
+            bool first = (hrtimer_heap == &(timer->hrtimer_node));
+            hrtimer_heap = skew_heap_remove(hrtimer_heap, &(timer->hrtimer_node), hrtimer_comp_f);
+            timer->pending = 0;
+            if (first) {
+                hrtimer_reprogram();
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+// hrtimer_expire - run every hrtimer with a deadline not later than @now
+static void
+hrtimer_expire(uint64_t now) {
+    while (hrtimer_heap != NULL) {
+        struct hrtimer *timer = le2hrtimer(hrtimer_heap, hrtimer_node);
+        if (timer->expires > now) {
+            break;
+        }
+        hrtimer_heap = skew_heap_remove(hrtimer_heap, &(timer->hrtimer_node), hrtimer_comp_f);
+        timer->pending = 0;
+        if (timer->func != NULL) {
+            timer->func(timer->arg);
+        }
+        else {
+            wakeup_proc(timer->proc);
+        }
+    }
+}
+
+// hrtimer_run - called by the timer interrupt, expire the hrtimers that are due
+void
+hrtimer_run(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        hrtimer_expire(get_cycles());
+        hrtimer_reprogram();
+    }
+    local_intr_restore(intr_flag);
+}
+
+#define CHECK_NR_HRTIMERS       1024
+
+static uint64_t check_now, check_last;
+static int check_fired;
+
+static void
+check_hrtimer_func(void *arg) {
+    struct hrtimer *timer = arg;
+    // in deadline order, and never before the deadline
+    assert(timer->expires <= check_now && timer->expires >= check_last);
+    check_last = timer->expires;
+    check_fired ++;
+}
+
+// check_hrtimer - expire many timers with a fake clock
+static void
+check_hrtimer(void) {
+    struct hrtimer *timers;
+    assert((timers = kmalloc(sizeof(struct hrtimer) * CHECK_NR_HRTIMERS)) != NULL);
+
+    uint64_t base = get_cycles() + (uint64_t)CLOCK_FREQ * 1000;
+    unsigned int seed = 1, i, nr_deleted = 0;
+    check_fired = 0, check_last = 0;
+    for (i = 0; i < CHECK_NR_HRTIMERS; i ++) {
+        seed = seed * 1103515245 + 12345;
+        hrtimer_init(timers + i, NULL, base + seed % CLOCK_FREQ);
+        timers[i].func = check_hrtimer_func, timers[i].arg = timers + i;
+        hrtimer_add(timers + i);
+    }
+    for (i = 0; i < CHECK_NR_HRTIMERS; i += 5) {
+        hrtimer_del(timers + i);
+        assert(!timers[i].pending);
+        nr_deleted ++;
+    }
+
+    // advance the fake clock in uneven steps, checking nothing due is left behind
+    for (check_now = base; check_now < base + CLOCK_FREQ; check_now += 1 + check_now % 7919) {
+        hrtimer_expire(check_now);
+        assert(hrtimer_heap == NULL || le2hrtimer(hrtimer_heap, hrtimer_node)->expires > check_now);
+    }
+    check_now = base + CLOCK_FREQ;
+    hrtimer_expire(check_now);
+    assert(hrtimer_heap == NULL && check_fired == CHECK_NR_HRTIMERS - nr_deleted);
+    for (i = 0; i < CHECK_NR_HRTIMERS; i ++) {
+        assert(!timers[i].pending);
+    }
+    hrtimer_reprogram();
+
+    kfree(timers);
+    cprintf("check_hrtimer() succeeded!\n");
+}
@@ -0,0 +1,43 @@
+#ifndef __KERN_SCHEDULE_HRTIMER_H__
+#define __KERN_SCHEDULE_HRTIMER_H__
+
+#include <defs.h>
+#include <skew_heap.h>
+
+struct proc_struct;
+
+/* *
+ * hrtimer - a timer that expires at an exact rdtime deadline instead of
+ * on a tick. Like timer_t, it either wakes up proc or calls func(arg)
+ * from the timer interrupt.
+ * */
+struct hrtimer {
+    uint64_t expires;                   // the deadline, in rdtime cycles
+    struct proc_struct *proc;           // the proc to wake up on expiry
+    void (*func)(void *arg);            // if not NULL, called with arg on expiry instead
+    void *arg;
+    bool pending;                       // is the timer in the heap?
+    skew_heap_entry_t hrtimer_node;     // the entry in the heap ordered by expires
+};
+
+#define le2hrtimer(le, member)          \
+    to_struct((le), struct hrtimer, member)
+
+static inline struct hrtimer *
+hrtimer_init(struct hrtimer *timer, struct proc_struct *proc, uint64_t expires) {
+    timer->expires = expires;
+    timer->proc = proc;
+    timer->func = NULL;
+    timer->arg = NULL;
+    timer->pending = 0;
+    skew_heap_init(&(timer->hrtimer_node));
+    return timer;
+}
+
+void hrtimers_init(void);
+void hrtimer_add(struct hrtimer *timer);
+void hrtimer_del(struct hrtimer *timer);
+void hrtimer_run(void);
+
+#endif /* !__KERN_SCHEDULE_HRTIMER_H__ */
+
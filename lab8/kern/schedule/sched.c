@@ -4,55 +4,172 @@
 #include <sched.h>
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
+#include <error.h>
+#include <unistd.h>
 #include <default_sched.h>
-
-// the list of timer
-static list_entry_t timer_list;
+#include <hrtimer.h>
+#include <clock.h>
+#include <mutex.h>
 
 static struct sched_class *sched_class;
 
-static struct run_queue *rq;
+/* *
+ * The scheduler classes that can be chosen at build time with
+ * "make SCHED=<name>", e.g. SCHED=MLFQ; the first class whose name starts
+ * with SCHED_CLASS is used. Without SCHED the first class is the default.
+ * */
+static struct sched_class *sched_classes[] = {
+    &default_sched_class,
+    &rr_sched_class,
+    &mlfq_sched_class,
+    &cfs_sched_class,
+};
+
+#define NR_SCHED_CLASSES (sizeof(sched_classes) / sizeof(sched_classes[0]))
+
+// real-time procs are scheduled by rt_sched_class, the others by sched_class
+static inline struct sched_class *
+proc_sched_class(struct proc_struct *proc) {
+    return (proc->sched_policy != SCHED_NORMAL) ? &rt_sched_class : sched_class;
+}
 
 static inline void
-sched_class_enqueue(struct proc_struct *proc) {
-    if (proc != idleproc) {
-        sched_class->enqueue(rq, proc);
+sched_class_enqueue(struct run_queue *rq, struct proc_struct *proc) {
+    if (proc != rq_cpu(rq)->idle) {
+        proc->rq_stamp = get_cycles();
+        proc_sched_class(proc)->enqueue(rq, proc);
     }
 }
 
 static inline void
-sched_class_dequeue(struct proc_struct *proc) {
-    sched_class->dequeue(rq, proc);
+sched_class_dequeue(struct run_queue *rq, struct proc_struct *proc) {
+    proc_sched_class(proc)->dequeue(rq, proc);
+}
+
+static inline void
+sched_class_put_prev(struct run_queue *rq, struct proc_struct *proc) {
+    struct sched_class *class = proc_sched_class(proc);
+    if (proc != rq_cpu(rq)->idle && class->put_prev != NULL) {
+        class->put_prev(rq, proc);
+    }
+}
+
+static inline void
+sched_class_wakeup(struct run_queue *rq, struct proc_struct *proc) {
+    struct sched_class *class = proc_sched_class(proc);
+    if (class->wakeup != NULL) {
+        class->wakeup(rq, proc);
+    }
 }
 
 static inline struct proc_struct *
-sched_class_pick_next(void) {
+sched_class_pick_next(struct run_queue *rq) {
+    struct proc_struct *next;
+    if ((next = rt_sched_class.pick_next(rq)) != NULL) {
+        return next;
+    }
     return sched_class->pick_next(rq);
 }
 
 static void
-sched_class_proc_tick(struct proc_struct *proc) {
+sched_class_proc_tick(struct run_queue *rq, struct proc_struct *proc) {
     if (proc != idleproc) {
-        sched_class->proc_tick(rq, proc);
+        proc_sched_class(proc)->proc_tick(rq, proc);
     }
     else {
         proc->need_resched = 1;
     }
 }
 
-static struct run_queue __rq;
-
 void
 sched_init(void) {
-    list_init(&timer_list);
+    timer_wheel_init();
+    hrtimers_init();
+
+    sched_class = sched_classes[0];
+#ifdef SCHED_CLASS
+    int i;
+    for (i = 0; i < NR_SCHED_CLASSES; i ++) {
+        if (strncmp(sched_classes[i]->name, SCHED_CLASS, strlen(SCHED_CLASS)) == 0) {
+            sched_class = sched_classes[i];
+            break;
+        }
+    }
+    if (i == NR_SCHED_CLASSES) {
+        warn("unknown sched class %s, use %s.\n", SCHED_CLASS, sched_class->name);
+    }
+#endif
+
+    sched_rq_init(&(cpus[0].rq));
 
-    sched_class = &default_sched_class;
+    cprintf("sched class: %s\n", sched_class->name);
+}
 
-    rq = &__rq;
+// sched_rq_init - initialize the run queue of a cpu
+void
+sched_rq_init(struct run_queue *rq) {
     rq->max_time_slice = MAX_TIME_SLICE;
     sched_class->init(rq);
+    rt_sched_class.init(rq);
+}
 
-    cprintf("sched class: %s\n", sched_class->name);
+// sched_proc_init - initialize the fields of a new proc used by the scheduler classes
+void
+sched_proc_init(struct proc_struct *proc) {
+    proc->mlfq_level = 0;
+    proc->mlfq_allot = 0;
+    proc->mlfq_epoch = 0;
+    proc->cfs_vruntime = 0;
+    proc->cfs_exec_start = 0;
+    proc->sched_policy = proc->base_policy = SCHED_NORMAL;
+    proc->rt_priority = proc->base_rt_priority = 0;
+    proc->base_priority = 0;
+    list_init(&(proc->pi_mutexes));
+    proc->pi_blocked_on = NULL;
+}
+
+/* *
+ * rt_preempt - check whether @proc should preempt the running process of
+ * @cpu: a real-time process wins over a normal one and over a real-time
+ * one of lower priority. The switch is done on the way back to user mode.
+ * */
+static void
+rt_preempt(struct cpu *cpu, struct proc_struct *proc) {
+    struct proc_struct *curr = cpu->proc;
+    if (proc->sched_policy == SCHED_NORMAL || curr == NULL || curr == cpu->idle) {
+        return;
+    }
+    if (curr->sched_policy == SCHED_NORMAL || curr->rt_priority < proc->rt_priority) {
+        curr->need_resched = 1;
+    }
+}
+
+// resched_cpu - make @cpu notice a new runnable proc: its idle loop, or a need_resched set for it
+static void
+resched_cpu(struct cpu *cpu) {
+    if (cpu != mycpu() && (cpu->proc == cpu->idle || cpu->proc->need_resched)) {
+        smp_send_ipi(cpu, IPI_RESCHED);
+    }
+}
+
+/* *
+ * select_cpu - the cpu to run a woken up @proc: the one it ran on last,
+ * where its cache may still be warm, unless that one is busy and another
+ * is idle.
+ * */
+static struct cpu *
+select_cpu(struct proc_struct *proc) {
+    struct cpu *cpu = (proc->rq != NULL) ? rq_cpu(proc->rq) : mycpu();
+    int i;
+    if (!cpu_is_idle(cpu)) {
+        for (i = 0; i < ncpu; i ++) {
+            if (cpu_is_idle(cpus + i)) {
+                return cpus + i;
+            }
+        }
+    }
+    return cpu;
 }
 
 void
@@ -65,7 +182,11 @@ wakeup_proc(struct proc_struct *proc) {
             proc->state = PROC_RUNNABLE;
             proc->wait_state = 0;
             if (proc != current) {
-                sched_class_enqueue(proc);
+                struct cpu *cpu = select_cpu(proc);
+                sched_class_wakeup(&(cpu->rq), proc);
+                sched_class_enqueue(&(cpu->rq), proc);
+                rt_preempt(cpu, proc);
+                resched_cpu(cpu);
             }
         }
         else {
@@ -75,102 +196,266 @@ wakeup_proc(struct proc_struct *proc) {
     local_intr_restore(intr_flag);
 }
 
-void
-schedule(void) {
+/* *
+ * sched_set_attr - change the scheduling attributes of @proc, moving it
+ * between the run queues of the classes if it is runnable.
+ * */
+static void
+sched_set_attr(struct proc_struct *proc, int policy, int rt_priority, uint32_t priority) {
+    // a runnable proc is on the run queue of its cpu unless it is running there
+    struct run_queue *rq = proc->rq;
+    bool queued = (proc->state == PROC_RUNNABLE && rq != NULL && rq_cpu(rq)->proc != proc);
+    if (queued) {
+        sched_class_dequeue(rq, proc);
+    }
+    proc->sched_policy = policy;
+    proc->rt_priority = rt_priority;
+    proc->lab6_priority = priority;
+    // the state kept by the old class while running is stale now
+    proc->time_slice = 0;
+    proc->cfs_exec_start = 0;
+    if (queued) {
+        sched_class_enqueue(rq, proc);
+        rt_preempt(rq_cpu(rq), proc);
+        resched_cpu(rq_cpu(rq));
+    }
+    else if (proc->state == PROC_RUNNABLE) {
+        // it is running: a lower priority may let someone else run
+        proc->need_resched = 1;
+        if (rq != NULL) {
+            resched_cpu(rq_cpu(rq));
+        }
+    }
+}
+
+/* *
+ * sched_setscheduler - set the scheduling policy of @proc to SCHED_NORMAL
+ * (@priority must be 0), SCHED_FIFO or SCHED_RR (@priority in
+ * 1 .. SCHED_RT_PRIO_MAX - 1). A priority it inherits is kept on top.
+ * */
+int
+sched_setscheduler(struct proc_struct *proc, int policy, int priority) {
+    if (policy == SCHED_NORMAL) {
+        if (priority != 0) {
+            return -E_INVAL;
+        }
+    }
+    else if (policy == SCHED_FIFO || policy == SCHED_RR) {
+        if (priority <= 0 || priority >= SCHED_RT_PRIO_MAX) {
+            return -E_INVAL;
+        }
+    }
+    else {
+        return -E_INVAL;
+    }
+
     bool intr_flag;
-    struct proc_struct *next;
     local_intr_save(intr_flag);
     {
-        current->need_resched = 0;
-        if (current->state == PROC_RUNNABLE) {
-            sched_class_enqueue(current);
+        proc->base_policy = policy;
+        proc->base_rt_priority = priority;
+        sched_set_attr(proc, policy, priority, proc->lab6_priority);
+        mutex_pi_update(proc);
+    }
+    local_intr_restore(intr_flag);
+    return 0;
+}
+
+// sched_prio_higher - @a goes before @b: real-time before normal, then the higher priority
+bool
+sched_prio_higher(struct proc_struct *a, struct proc_struct *b) {
+    if ((a->sched_policy != SCHED_NORMAL) != (b->sched_policy != SCHED_NORMAL)) {
+        return a->sched_policy != SCHED_NORMAL;
+    }
+    if (a->sched_policy != SCHED_NORMAL) {
+        return a->rt_priority > b->rt_priority;
+    }
+    return a->lab6_priority > b->lab6_priority;
+}
+
+/* *
+ * sched_pi_inherit - priority inheritance: set @proc to its own policy
+ * and priorities, raised to those of @donor (NULL for none). A real-time
+ * donor lends its policy and rt_priority, any donor its lab6_priority,
+ * which is the share of the stride and CFS classes.
+ * */
+void
+sched_pi_inherit(struct proc_struct *proc, struct proc_struct *donor) {
+    int policy = proc->base_policy, rt_priority = proc->base_rt_priority;
+    uint32_t priority = proc->base_priority;
+    if (donor != NULL) {
+        if (donor->sched_policy != SCHED_NORMAL
+                && (policy == SCHED_NORMAL || donor->rt_priority > rt_priority)) {
+            policy = donor->sched_policy, rt_priority = donor->rt_priority;
         }
-        if ((next = sched_class_pick_next()) != NULL) {
-            sched_class_dequeue(next);
+        if (donor->lab6_priority > priority) {
+            priority = donor->lab6_priority;
         }
-        if (next == NULL) {
-            next = idleproc;
+    }
+    if (policy != proc->sched_policy || rt_priority != proc->rt_priority || priority != proc->lab6_priority) {
+        sched_set_attr(proc, policy, rt_priority, priority);
+    }
+}
+
+/* *
+ * load_balance - work stealing for a cpu that found nothing to run: move
+ * a runnable proc from the busiest run queue of another cpu to @rq, a
+ * real-time one if there is one. Return 1 if a proc was moved.
+ * */
+static int
+load_balance(struct run_queue *rq) {
+    struct run_queue *busiest = NULL;
+    int i;
+    for (i = 0; i < ncpu; i ++) {
+        struct run_queue *other = &(cpus[i].rq);
+        if (other != rq && cpus[i].online && other->proc_num > 0) {
+            if (busiest == NULL || other->proc_num > busiest->proc_num) {
+                busiest = other;
+            }
         }
-        next->runs ++;
-        if (next != current) {
-            proc_run(next);
+    }
+    if (busiest == NULL) {
+        return 0;
+    }
+    struct sched_class *classes[] = {&rt_sched_class, sched_class};
+    for (i = 0; i < sizeof(classes) / sizeof(classes[0]); i ++) {
+        struct proc_struct *proc;
+        if (classes[i]->get_proc != NULL && (proc = classes[i]->get_proc(rq, busiest)) != NULL) {
+            classes[i]->enqueue(rq, proc);
+            return 1;
         }
     }
-    local_intr_restore(intr_flag);
+    return 0;
+}
+
+/* *
+ * CPU accounting: the time since current->acct_stamp is charged to its
+ * utime when it traps from user mode, and to its stime when it returns to
+ * user mode or is switched out. How long a proc waited on a run queue is
+ * added up per proc and counted in rq_delay_hist, whose bucket i > 0
+ * holds the waits of 2^i .. 2^(i+1) - 1 usecs.
+ * */
+
+#define RQ_DELAY_BUCKETS            16
+#define CYCLES_PER_USEC             (CLOCK_FREQ / 1000000)
+
+static unsigned int rq_delay_hist[RQ_DELAY_BUCKETS];
+
+// sched_acct_user - current trapped from user mode, charge its user time
+void
+sched_acct_user(void) {
+    uint64_t now = get_cycles();
+    current->acct.utime += now - current->acct_stamp;
+    current->acct_stamp = now;
+}
+
+// sched_acct_system - current returns to user mode, charge its time in the kernel
+void
+sched_acct_system(void) {
+    uint64_t now = get_cycles();
+    current->acct.stime += now - current->acct_stamp;
+    current->acct_stamp = now;
 }
 
-// add timer to timer_list
+// sched_acct_switch - called by schedule when @prev gives the cpu to @next
+static void
+sched_acct_switch(struct proc_struct *prev, struct proc_struct *next) {
+    uint64_t now = get_cycles();
+    prev->acct.stime += now - prev->acct_stamp;
+    if (prev->state == PROC_RUNNABLE) {
+        prev->acct.nivcsw ++;
+    }
+    else {
+        prev->acct.nvcsw ++;
+    }
+    next->acct_stamp = now;
+
+    if (next != idleproc) {
+        uint64_t delay = now - next->rq_stamp, usecs = delay / CYCLES_PER_USEC;
+        next->acct.rq_delay += delay;
+        if (delay > next->acct.rq_delay_max) {
+            next->acct.rq_delay_max = delay;
+        }
+        int i = 0;
+        while (usecs >= 2 && i < RQ_DELAY_BUCKETS - 1) {
+            usecs >>= 1, i ++;
+        }
+        rq_delay_hist[i] ++;
+    }
+}
+
+// sched_print_rq_delay - print the histogram of the run queue waits
 void
-add_timer(timer_t *timer) {
+sched_print_rq_delay(void) {
     bool intr_flag;
     local_intr_save(intr_flag);
     {
-        assert(timer->expires > 0 && timer->proc != NULL);
-        assert(list_empty(&(timer->timer_link)));
-        list_entry_t *le = list_next(&timer_list);
-        while (le != &timer_list) {
-            timer_t *next = le2timer(le, timer_link);
-            if (timer->expires < next->expires) {
-                next->expires -= timer->expires;
-                break;
+        int i, j, len;
+        unsigned int max = 0;
+        for (i = 0; i < RQ_DELAY_BUCKETS; i ++) {
+            max = (rq_delay_hist[i] > max) ? rq_delay_hist[i] : max;
+        }
+        cprintf("run queue delay (usecs):\n");
+        for (i = 0; i < RQ_DELAY_BUCKETS; i ++) {
+            if (i < RQ_DELAY_BUCKETS - 1) {
+                cprintf("  < %6d %8d ", 2 << i, rq_delay_hist[i]);
+            }
+            else {
+                cprintf("  >=%6d %8d ", 1 << i, rq_delay_hist[i]);
+            }
+            len = (max != 0) ? (rq_delay_hist[i] * 50 + max - 1) / max : 0;
+            for (j = 0; j < len; j ++) {
+                cputchar('#');
             }
-            timer->expires -= next->expires;
-            le = list_next(le);
+            cputchar('\n');
         }
-        list_add_before(le, &(timer->timer_link));
     }
     local_intr_restore(intr_flag);
 }
 
-// del timer from timer_list
 void
-del_timer(timer_t *timer) {
+schedule(void) {
     bool intr_flag;
+    struct proc_struct *next;
     local_intr_save(intr_flag);
     {
-        if (!list_empty(&(timer->timer_link))) {
-            if (timer->expires != 0) {
-                list_entry_t *le = list_next(&(timer->timer_link));
-                if (le != &timer_list) {
-                    timer_t *next = le2timer(le, timer_link);
-                    next->expires += timer->expires;
-                }
-            }
-            list_del_init(&(timer->timer_link));
+        struct run_queue *rq = &(mycpu()->rq);
+        current->need_resched = 0;
+        sched_class_put_prev(rq, current);
+        if (current->state == PROC_RUNNABLE) {
+            sched_class_enqueue(rq, current);
+        }
+        next = sched_class_pick_next(rq);
+        if (next == NULL && ncpu > 1 && load_balance(rq)) {
+            next = sched_class_pick_next(rq);
+        }
+        if (next != NULL) {
+            sched_class_dequeue(rq, next);
+        }
+        if (next == NULL) {
+            next = idleproc;
+        }
+        next->runs ++;
+        if (next != current) {
+            sched_acct_switch(current, next);
+            fpu_switch_out(current);
+            proc_run(next);
         }
     }
     local_intr_restore(intr_flag);
 }
 
 // call scheduler to update tick related info, and check the timer is expired? If expired, then wakup proc
+// The timer wheel is run by the boot cpu only.
 void
 run_timer_list(void) {
     bool intr_flag;
     local_intr_save(intr_flag);
     {
-        list_entry_t *le = list_next(&timer_list);
-        if (le != &timer_list) {
-            timer_t *timer = le2timer(le, timer_link);
-            assert(timer->expires != 0);
-            timer->expires --;
-            while (timer->expires == 0) {
-                le = list_next(le);
-                struct proc_struct *proc = timer->proc;
-                if (proc->wait_state != 0) {
-                    assert(proc->wait_state & WT_INTERRUPTED);
-                }
-                else {
-                    warn("process %d's wait_state == 0.\n", proc->pid);
-                }
-                wakeup_proc(proc);
-                del_timer(timer);
-                if (le == &timer_list) {
-                    break;
-                }
-                timer = le2timer(le, timer_link);
-            }
+        if (cpu_is_boot()) {
+            run_timers();
         }
-        if(current)sched_class_proc_tick(current);
+        if(current)sched_class_proc_tick(&(mycpu()->rq), current);
     }
     local_intr_restore(intr_flag);
 }
@@ -4,28 +4,14 @@
 #include <defs.h>
 #include <list.h>
 #include <skew_heap.h>
+#include <unistd.h>
+#include <timer.h>
 
 #define MAX_TIME_SLICE 5
 
-struct proc_struct;
-
-typedef struct {
-    unsigned int expires;       //the expire time
-    struct proc_struct *proc;   //the proc wait in this timer. If the expire time is end, then this proc will be scheduled
-    list_entry_t timer_link;    //the timer list
-} timer_t;
+#define MLFQ_NR_LEVELS 4
 
-#define le2timer(le, member)            \
-to_struct((le), timer_t, member)
-
-// init a timer
-static inline timer_t *
-timer_init(timer_t *timer, struct proc_struct *proc, int expires) {
-    timer->expires = expires;
-    timer->proc = proc;
-    list_init(&(timer->timer_link));
-    return timer;
-}
+struct proc_struct;
 
 struct run_queue;
 
@@ -45,13 +31,14 @@ struct sched_class {
     struct proc_struct *(*pick_next)(struct run_queue *rq);
     // dealer of the time-tick
     void (*proc_tick)(struct run_queue *rq, struct proc_struct *proc);
-    /* for SMP support in the future
-     *  load_balance
-     *     void (*load_balance)(struct rq* rq);
-     *  get some proc from this rq, used in load_balance,
-     *  return value is the num of gotten proc
-     *  int (*get_proc)(struct rq* rq, struct proc* procs_moved[]);
-     */
+    // optional, called by schedule when @proc stops running, before it is put back
+    // into runqueue (if still runnable) and whatever the class of the next proc is
+    void (*put_prev)(struct run_queue *rq, struct proc_struct *proc);
+    // optional, called by wakeup_proc before a sleeping proc is put into runqueue
+    void (*wakeup)(struct run_queue *rq, struct proc_struct *proc);
+    // optional, used by load_balance: take a runnable proc off @busiest to move it
+    // to @rq, and return it; NULL if this class has nothing to move
+    struct proc_struct *(*get_proc)(struct run_queue *rq, struct run_queue *busiest);
 };
 
 struct run_queue {
@@ -60,13 +47,28 @@ struct run_queue {
     int max_time_slice;
     // For LAB6 ONLY
     skew_heap_entry_t *lab6_run_pool;
+    // For the MLFQ scheduler: one list per priority level, ticks since the last boost, and boosts so far
+    list_entry_t mlfq_list[MLFQ_NR_LEVELS];
+    unsigned int mlfq_boost_ticks;
+    unsigned int mlfq_boost_epoch;
+    // For the CFS scheduler: lower bound of the vruntime of the runnable procs
+    uint64_t cfs_min_vruntime;
+    // For the real-time scheduler: one list per priority, and a bitmap of the non-empty ones
+    list_entry_t rt_list[SCHED_RT_PRIO_MAX];
+    uint32_t rt_bitmap;
 };
 
 void sched_init(void);
+void sched_rq_init(struct run_queue *rq);
+void sched_proc_init(struct proc_struct *proc);
 void wakeup_proc(struct proc_struct *proc);
+int sched_setscheduler(struct proc_struct *proc, int policy, int priority);
+bool sched_prio_higher(struct proc_struct *a, struct proc_struct *b);
+void sched_pi_inherit(struct proc_struct *proc, struct proc_struct *donor);
 void schedule(void);
-void add_timer(timer_t *timer);     // add timer to timer_list
-void del_timer(timer_t *timer);     // del timer from timer_list
+void sched_acct_user(void);
+void sched_acct_system(void);
+void sched_print_rq_delay(void);
 void run_timer_list(void);          // call scheduler to update tick related info, and check the timer is expired? If expired, then wakup proc
 
 #endif /* !__KERN_SCHEDULE_SCHED_H__ */
@@ -0,0 +1,191 @@
+#include <defs.h>
+#include <list.h>
+#include <proc.h>
+#include <clock.h>
+#include <assert.h>
+#include <skew_heap.h>
+#include <default_sched.h>
+
+/* *
+ * Completely fair scheduler
+ *
+ * Every process has a virtual runtime: the cpu time it consumed, measured
+ * with rdtime and divided by its weight. The weight is the priority set by
+ * lab6_set_priority (at least 1), so a process of priority 3 gets three
+ * times the cpu of a process of priority 1 when both are runnable.
+ * Runnable processes are kept in the skew heap rq->lab6_run_pool ordered
+ * by vruntime, and pick_next always takes the one with the least.
+ *
+ *  - The running process is preempted on a tick once its vruntime is more
+ *    than CFS_MIN_GRAN ahead of the leftmost runnable process.
+ *  - rq->cfs_min_vruntime follows the least vruntime of the queue and never
+ *    goes back. A new process starts there, so it cannot monopolize the cpu.
+ *  - A process woken up after sleeping is put at least at cfs_min_vruntime
+ *    - CFS_SLEEPER_CREDIT: it cannot save up cpu time while sleeping, but an
+ *    interactive process still runs soon after waking up. If it is then
+ *    CFS_WAKEUP_GRAN behind the running process, that process is preempted.
+ * */
+
+#define CFS_LATENCY             (MAX_TIME_SLICE * CLOCK_TICK_CYCLES)
+#define CFS_MIN_GRAN            (CLOCK_TICK_CYCLES)
+#define CFS_WAKEUP_GRAN         (CLOCK_TICK_CYCLES)
+#define CFS_SLEEPER_CREDIT      (CFS_LATENCY / 2)
+
+#define vruntime_before(a, b)   ((int64_t)((a) - (b)) < 0)
+
+static inline uint32_t
+cfs_weight(struct proc_struct *proc) {
+    return (proc->lab6_priority != 0) ? proc->lab6_priority : 1;
+}
+
+static int
+proc_vruntime_comp_f(void *a, void *b) {
+    struct proc_struct *p = le2proc(a, lab6_run_pool);
+    struct proc_struct *q = le2proc(b, lab6_run_pool);
+    int64_t c = (int64_t)(p->cfs_vruntime - q->cfs_vruntime);
+    if (c > 0) return 1;
+    else if (c == 0) return 0;
+    else return -1;
+}
+
+static inline struct proc_struct *
+cfs_leftmost(struct run_queue *rq) {
+    return (rq->lab6_run_pool != NULL) ? le2proc(rq->lab6_run_pool, lab6_run_pool) : NULL;
+}
+
+// cfs_update_curr - charge the cpu time used since cfs_exec_start to @proc
+static void
+cfs_update_curr(struct proc_struct *proc) {
+    if (proc->cfs_exec_start != 0) {
+        uint64_t now = get_cycles();
+        proc->cfs_vruntime += (now - proc->cfs_exec_start) / cfs_weight(proc);
+        proc->cfs_exec_start = now;
+    }
+}
+
+// cfs_update_min_vruntime - advance cfs_min_vruntime, @curr is the running proc or NULL
+static void
+cfs_update_min_vruntime(struct run_queue *rq, struct proc_struct *curr) {
+    struct proc_struct *left = cfs_leftmost(rq);
+    uint64_t vruntime;
+    if (left == NULL && curr == NULL) {
+        return;
+    }
+    if (left == NULL) {
+        vruntime = curr->cfs_vruntime;
+    }
+    else if (curr == NULL || vruntime_before(left->cfs_vruntime, curr->cfs_vruntime)) {
+        vruntime = left->cfs_vruntime;
+    }
+    else {
+        vruntime = curr->cfs_vruntime;
+    }
+    if (vruntime_before(rq->cfs_min_vruntime, vruntime)) {
+        rq->cfs_min_vruntime = vruntime;
+    }
+}
+
+static void
+cfs_init(struct run_queue *rq) {
+    list_init(&(rq->run_list));
+    rq->lab6_run_pool = NULL;
+    rq->cfs_min_vruntime = 0;
+    rq->proc_num = 0;
+}
+
+static void
+cfs_enqueue(struct run_queue *rq, struct proc_struct *proc) {
+    // a process put back was charged by cfs_put_prev, its key is up to date
+    assert(proc->cfs_exec_start == 0);
+    skew_heap_init(&(proc->lab6_run_pool));
+    rq->lab6_run_pool = skew_heap_insert(rq->lab6_run_pool, &(proc->lab6_run_pool), proc_vruntime_comp_f);
+    proc->time_slice = rq->max_time_slice;
+    proc->rq = rq;
+    rq->proc_num ++;
+}
+
+static void
+cfs_dequeue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(proc->rq == rq && rq->proc_num > 0);
+    rq->lab6_run_pool = skew_heap_remove(rq->lab6_run_pool, &(proc->lab6_run_pool), proc_vruntime_comp_f);
+    rq->proc_num --;
+}
+
+static struct proc_struct *
+cfs_pick_next(struct run_queue *rq) {
+    struct proc_struct *next;
+    if ((next = cfs_leftmost(rq)) == NULL) {
+        return NULL;
+    }
+    cfs_update_min_vruntime(rq, NULL);
+    next->cfs_exec_start = get_cycles();
+    return next;
+}
+
+// cfs_put_prev - @proc stops running, to be put back, to sleep or to exit: charge it
+static void
+cfs_put_prev(struct run_queue *rq, struct proc_struct *proc) {
+    if (proc->cfs_exec_start != 0) {
+        cfs_update_curr(proc);
+        proc->cfs_exec_start = 0;
+    }
+}
+
+static void
+cfs_proc_tick(struct run_queue *rq, struct proc_struct *proc) {
+    cfs_update_curr(proc);
+    cfs_update_min_vruntime(rq, proc);
+    struct proc_struct *left = cfs_leftmost(rq);
+    if (left != NULL && (int64_t)(proc->cfs_vruntime - left->cfs_vruntime) > CFS_MIN_GRAN) {
+        proc->need_resched = 1;
+    }
+}
+
+static void
+cfs_wakeup(struct run_queue *rq, struct proc_struct *proc) {
+    // moved to another cpu by select_cpu: rebase it as cfs_get_proc does
+    if (proc->rq != NULL && proc->rq != rq) {
+        proc->cfs_vruntime = proc->cfs_vruntime - proc->rq->cfs_min_vruntime + rq->cfs_min_vruntime;
+    }
+    uint64_t vruntime = rq->cfs_min_vruntime;
+    if (proc->runs != 0) {
+        vruntime -= CFS_SLEEPER_CREDIT;
+    }
+    if (vruntime_before(proc->cfs_vruntime, vruntime)) {
+        proc->cfs_vruntime = vruntime;
+    }
+    struct proc_struct *curr = rq_cpu(rq)->proc;
+    if (curr != NULL && curr != rq_cpu(rq)->idle && curr->cfs_exec_start != 0) {
+        cfs_update_curr(curr);
+        if ((int64_t)(curr->cfs_vruntime - proc->cfs_vruntime) > CFS_WAKEUP_GRAN) {
+            curr->need_resched = 1;
+        }
+    }
+}
+
+/* *
+ * cfs_get_proc - for load_balance: the leftmost proc of @busiest. Its
+ * vruntime is moved by the difference of the two cfs_min_vruntime, so it
+ * keeps its place relative to the others.
+ * */
+static struct proc_struct *
+cfs_get_proc(struct run_queue *rq, struct run_queue *busiest) {
+    struct proc_struct *proc;
+    if ((proc = cfs_leftmost(busiest)) != NULL) {
+        cfs_dequeue(busiest, proc);
+        proc->cfs_vruntime = proc->cfs_vruntime - busiest->cfs_min_vruntime + rq->cfs_min_vruntime;
+    }
+    return proc;
+}
+
+struct sched_class cfs_sched_class = {
+    .name = "CFS_scheduler",
+    .init = cfs_init,
+    .enqueue = cfs_enqueue,
+    .dequeue = cfs_dequeue,
+    .pick_next = cfs_pick_next,
+    .proc_tick = cfs_proc_tick,
+    .put_prev = cfs_put_prev,
+    .wakeup = cfs_wakeup,
+    .get_proc = cfs_get_proc,
+};
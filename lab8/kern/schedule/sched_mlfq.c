@@ -0,0 +1,183 @@
+#include <defs.h>
+#include <list.h>
+#include <proc.h>
+#include <assert.h>
+#include <default_sched.h>
+
+/* *
+ * Multi-level feedback queue scheduler
+ *
+ * There are MLFQ_NR_LEVELS round-robin queues; level 0 has the highest
+ * priority and the shortest time slice, each lower level doubles it.
+ * pick_next always takes the head of the highest non-empty level.
+ *
+ *  - A process starts at level 0.
+ *  - Each process gets an allotment of CPU ticks at its level. The
+ *    allotment is not refilled when the process sleeps, so a process
+ *    that sleeps just before its slice ends still gets demoted once it
+ *    has used up the allotment.
+ *  - When a sleeping process is woken up (I/O done, timer expired, child
+ *    exited, ...) with allotment left, it is promoted one level. It keeps
+ *    what is left of its allotment, up to the allotment of the new level.
+ *    If it then outranks the running process, that process is preempted.
+ *  - Every MLFQ_BOOST_TICKS all processes are moved back to level 0, so
+ *    CPU-bound processes cannot starve and a process whose behaviour
+ *    changed gets a fresh start. A process that slept through a boost of
+ *    its run queue is moved to level 0 when it wakes up.
+ * */
+
+#define MLFQ_BASE_SLICE             2       // time slice of level 0, in ticks
+#define MLFQ_ALLOT_SLICES           2       // allotment of a level, in time slices of that level
+#define MLFQ_BOOST_TICKS            100     // period of the priority boost
+
+#define mlfq_slice(level)           (MLFQ_BASE_SLICE << (level))
+#define mlfq_allotment(level)       (mlfq_slice(level) * MLFQ_ALLOT_SLICES)
+
+static void
+mlfq_init(struct run_queue *rq) {
+    int i;
+    list_init(&(rq->run_list));
+    for (i = 0; i < MLFQ_NR_LEVELS; i ++) {
+        list_init(&(rq->mlfq_list[i]));
+    }
+    rq->mlfq_boost_ticks = 0;
+    rq->mlfq_boost_epoch = 0;
+    rq->proc_num = 0;
+}
+
+static void
+mlfq_enqueue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(list_empty(&(proc->run_link)));
+    int level = proc->mlfq_level;
+    assert(level >= 0 && level < MLFQ_NR_LEVELS);
+    list_add_before(&(rq->mlfq_list[level]), &(proc->run_link));
+    if (proc->time_slice <= 0 || proc->time_slice > mlfq_slice(level)) {
+        proc->time_slice = mlfq_slice(level);
+    }
+    if (proc->mlfq_allot <= 0) {
+        proc->mlfq_allot = mlfq_allotment(level);
+    }
+    proc->mlfq_epoch = rq->mlfq_boost_epoch;
+    proc->rq = rq;
+    rq->proc_num ++;
+}
+
+static void
+mlfq_dequeue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(!list_empty(&(proc->run_link)) && proc->rq == rq);
+    list_del_init(&(proc->run_link));
+    rq->proc_num --;
+}
+
+static struct proc_struct *
+mlfq_pick_next(struct run_queue *rq) {
+    int i;
+    for (i = 0; i < MLFQ_NR_LEVELS; i ++) {
+        list_entry_t *le = list_next(&(rq->mlfq_list[i]));
+        if (le != &(rq->mlfq_list[i])) {
+            return le2proc(le, run_link);
+        }
+    }
+    return NULL;
+}
+
+static void
+mlfq_set_level(struct proc_struct *proc, int level) {
+    proc->mlfq_level = level;
+    proc->mlfq_allot = mlfq_allotment(level);
+    proc->time_slice = mlfq_slice(level);
+}
+
+// mlfq_boost - move every process back to level 0
+static void
+mlfq_boost(struct run_queue *rq, struct proc_struct *running) {
+    int i;
+    // the sleepers are moved on wakeup, by the epoch
+    rq->mlfq_boost_epoch ++;
+    list_entry_t *le = &(rq->mlfq_list[0]);
+    while ((le = list_next(le)) != &(rq->mlfq_list[0])) {
+        le2proc(le, run_link)->mlfq_epoch = rq->mlfq_boost_epoch;
+    }
+    for (i = 1; i < MLFQ_NR_LEVELS; i ++) {
+        list_entry_t *list = &(rq->mlfq_list[i]);
+        while ((le = list_next(list)) != list) {
+            struct proc_struct *proc = le2proc(le, run_link);
+            list_del(le);
+            list_add_before(&(rq->mlfq_list[0]), le);
+            mlfq_set_level(proc, 0);
+            proc->mlfq_epoch = rq->mlfq_boost_epoch;
+        }
+    }
+    running->mlfq_epoch = rq->mlfq_boost_epoch;
+    if (running->mlfq_level != 0) {
+        mlfq_set_level(running, 0);
+        running->need_resched = 1;
+    }
+}
+
+static void
+mlfq_proc_tick(struct run_queue *rq, struct proc_struct *proc) {
+    if (proc->time_slice > 0) {
+        proc->time_slice --;
+    }
+    if (-- proc->mlfq_allot <= 0) {
+        if (proc->mlfq_level < MLFQ_NR_LEVELS - 1) {
+            proc->mlfq_level ++;
+        }
+        mlfq_set_level(proc, proc->mlfq_level);
+        proc->need_resched = 1;
+    }
+    if (proc->time_slice == 0) {
+        proc->need_resched = 1;
+    }
+    if (++ rq->mlfq_boost_ticks >= MLFQ_BOOST_TICKS) {
+        rq->mlfq_boost_ticks = 0;
+        mlfq_boost(rq, proc);
+    }
+}
+
+static void
+mlfq_wakeup(struct run_queue *rq, struct proc_struct *proc) {
+    // proc->rq is still the run queue it slept on, rq may be another cpu's
+    if (proc->rq != NULL && proc->mlfq_epoch != proc->rq->mlfq_boost_epoch) {
+        mlfq_set_level(proc, 0);
+    }
+    else if (proc->mlfq_level > 0 && proc->mlfq_allot > 0) {
+        // only the level changes, sleeping does not refill the allotment
+        proc->mlfq_level --;
+        if (proc->mlfq_allot > mlfq_allotment(proc->mlfq_level)) {
+            proc->mlfq_allot = mlfq_allotment(proc->mlfq_level);
+        }
+    }
+    struct proc_struct *curr = rq_cpu(rq)->proc;
+    if (curr != NULL && curr != rq_cpu(rq)->idle && proc->mlfq_level < curr->mlfq_level) {
+        curr->need_resched = 1;
+    }
+}
+
+// mlfq_get_proc - for load_balance: the tail of the lowest non-empty level, the proc that would wait longest
+static struct proc_struct *
+mlfq_get_proc(struct run_queue *rq, struct run_queue *busiest) {
+    int i;
+    for (i = MLFQ_NR_LEVELS - 1; i >= 0; i --) {
+        list_entry_t *le = list_prev(&(busiest->mlfq_list[i]));
+        if (le != &(busiest->mlfq_list[i])) {
+            struct proc_struct *proc = le2proc(le, run_link);
+            mlfq_dequeue(busiest, proc);
+            return proc;
+        }
+    }
+    return NULL;
+}
+
+struct sched_class mlfq_sched_class = {
+    .name = "MLFQ_scheduler",
+    .init = mlfq_init,
+    .enqueue = mlfq_enqueue,
+    .dequeue = mlfq_dequeue,
+    .pick_next = mlfq_pick_next,
+    .proc_tick = mlfq_proc_tick,
+    .wakeup = mlfq_wakeup,
+    .get_proc = mlfq_get_proc,
+};
+
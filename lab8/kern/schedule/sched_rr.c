@@ -47,12 +47,25 @@ RR_proc_tick(struct run_queue *rq, struct proc_struct *proc) {
     }
 }
 
-struct sched_class default_sched_class = {
+// RR_get_proc - for load_balance: the tail of the queue, the proc that would wait longest
+static struct proc_struct *
+RR_get_proc(struct run_queue *rq, struct run_queue *busiest) {
+    list_entry_t *le = list_prev(&(busiest->run_list));
+    if (le != &(busiest->run_list)) {
+        struct proc_struct *proc = le2proc(le, run_link);
+        RR_dequeue(busiest, proc);
+        return proc;
+    }
+    return NULL;
+}
+
+struct sched_class rr_sched_class = {
     .name = "RR_scheduler",
     .init = RR_init,
     .enqueue = RR_enqueue,
     .dequeue = RR_dequeue,
     .pick_next = RR_pick_next,
     .proc_tick = RR_proc_tick,
+    .get_proc = RR_get_proc,
 };
 
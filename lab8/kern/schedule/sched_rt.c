@@ -0,0 +1,98 @@
+#include <defs.h>
+#include <list.h>
+#include <proc.h>
+#include <assert.h>
+#include <default_sched.h>
+
+/* *
+ * Real-time scheduler, for processes with policy SCHED_FIFO or SCHED_RR
+ *
+ * It is not one of the classes chosen by SCHED at build time: sched.c puts
+ * real-time processes here and always asks this class first, so any
+ * runnable real-time process runs before every normal process.
+ *
+ * There is one queue per static priority (1 .. SCHED_RT_PRIO_MAX - 1, the
+ * higher the better) and a bitmap of the non-empty ones. pick_next takes
+ * the head of the highest non-empty queue.
+ *  - SCHED_FIFO runs until it blocks, yields or is preempted by a higher
+ *    priority; it has no time slice.
+ *  - SCHED_RR is the same, but when its time slice runs out it goes to the
+ *    tail of its queue.
+ * A preempted process goes back to the head of its queue, a woken up or
+ * yielding one to the tail.
+ * */
+
+static void
+rt_init(struct run_queue *rq) {
+    int i;
+    for (i = 0; i < SCHED_RT_PRIO_MAX; i ++) {
+        list_init(&(rq->rt_list[i]));
+    }
+    rq->rt_bitmap = 0;
+}
+
+static void
+rt_enqueue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(list_empty(&(proc->run_link)));
+    int prio = proc->rt_priority;
+    assert(prio > 0 && prio < SCHED_RT_PRIO_MAX);
+    if (proc == current && proc->time_slice > 0) {
+        list_add_after(&(rq->rt_list[prio]), &(proc->run_link));
+    }
+    else {
+        list_add_before(&(rq->rt_list[prio]), &(proc->run_link));
+        proc->time_slice = rq->max_time_slice;
+    }
+    rq->rt_bitmap |= (1U << prio);
+    proc->rq = rq;
+    rq->proc_num ++;
+}
+
+static void
+rt_dequeue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(!list_empty(&(proc->run_link)) && proc->rq == rq);
+    list_del_init(&(proc->run_link));
+    if (list_empty(&(rq->rt_list[proc->rt_priority]))) {
+        rq->rt_bitmap &= ~(1U << proc->rt_priority);
+    }
+    rq->proc_num --;
+}
+
+static struct proc_struct *
+rt_pick_next(struct run_queue *rq) {
+    int prio;
+    if (rq->rt_bitmap == 0) {
+        return NULL;
+    }
+    for (prio = SCHED_RT_PRIO_MAX - 1; !(rq->rt_bitmap & (1U << prio)); prio --)
+        /* nothing */ ;
+    return le2proc(list_next(&(rq->rt_list[prio])), run_link);
+}
+
+static void
+rt_proc_tick(struct run_queue *rq, struct proc_struct *proc) {
+    if (proc->sched_policy == SCHED_RR && -- proc->time_slice <= 0) {
+        proc->time_slice = 0;
+        proc->need_resched = 1;
+    }
+}
+
+// rt_get_proc - for load_balance: the proc of @busiest that would run next there
+static struct proc_struct *
+rt_get_proc(struct run_queue *rq, struct run_queue *busiest) {
+    struct proc_struct *proc;
+    if ((proc = rt_pick_next(busiest)) != NULL) {
+        rt_dequeue(busiest, proc);
+    }
+    return proc;
+}
+
+struct sched_class rt_sched_class = {
+    .name = "RT_scheduler",
+    .init = rt_init,
+    .enqueue = rt_enqueue,
+    .dequeue = rt_dequeue,
+    .pick_next = rt_pick_next,
+    .proc_tick = rt_proc_tick,
+    .get_proc = rt_get_proc,
+};
@@ -0,0 +1,279 @@
+#include <defs.h>
+#include <list.h>
+#include <sync.h>
+#include <proc.h>
+#include <sched.h>
+#include <stdio.h>
+#include <assert.h>
+#include <kmalloc.h>
+#include <clock.h>
+#include <timer.h>
+
+/* *
+ * Hierarchical timer wheel
+ *
+ * Timers are hashed by their expire tick into buckets. tv1 has one bucket
+ * per tick for the next TVR_SIZE ticks. Each of the TVN_LEVELS levels of
+ * tvn covers a range TVN_SIZE times as long as the one below, with one
+ * bucket per TVR_SIZE, TVR_SIZE * TVN_SIZE, ... ticks. Together they
+ * cover 2^26 ticks (about 7 days); later timers are clamped to that.
+ *
+ * add_timer and del_timer are O(1) list operations. Each tick run_timers
+ * runs the timers in one tv1 bucket. Every TVR_SIZE ticks a bucket of the
+ * first level is cascaded: its timers are re-hashed into tv1, now that
+ * they are closer. The same happens one level up when that level wraps.
+ *
+ * A timer with slack may expire up to slack ticks late. add_timer rounds
+ * its expire tick up to the roundest tick within the slack, so timers with
+ * near-identical expiries share a tick and are cascaded and run together.
+ * */
+
+#define TVR_BITS                8
+#define TVN_BITS                6
+#define TVR_SIZE                (1 << TVR_BITS)
+#define TVN_SIZE                (1 << TVN_BITS)
+#define TVR_MASK                (TVR_SIZE - 1)
+#define TVN_MASK                (TVN_SIZE - 1)
+#define TVN_LEVELS              3
+#define MAX_TVAL                ((1UL << (TVR_BITS + TVN_LEVELS * TVN_BITS)) - 1)
+
+#define TVN_SHIFT(n)            (TVR_BITS + (n) * TVN_BITS)
+#define TVN_INDEX(n, t)         (((t) >> TVN_SHIFT(n)) & TVN_MASK)
+
+static list_entry_t tv1[TVR_SIZE];
+static list_entry_t tvn[TVN_LEVELS][TVN_SIZE];
+// the next tick to be processed by run_timers
+static size_t timer_jiffies;
+
+static void check_timer(void);
+
+void
+timer_wheel_init(void) {
+    int i, n;
+    for (i = 0; i < TVR_SIZE; i ++) {
+        list_init(tv1 + i);
+    }
+    for (n = 0; n < TVN_LEVELS; n ++) {
+        for (i = 0; i < TVN_SIZE; i ++) {
+            list_init(tvn[n] + i);
+        }
+    }
+    timer_jiffies = 0;
+    check_timer();
+}
+
+// internal_add_timer - put @timer into the bucket of its absolute expire tick
+static void
+internal_add_timer(timer_t *timer) {
+    size_t expires = timer->expires, idx = expires - timer_jiffies;
+    list_entry_t *bucket;
+    int n;
+    if ((long)idx < 0) {
+        // already expired, run it on the next tick
+        bucket = tv1 + (timer_jiffies & TVR_MASK);
+    }
+    else if (idx < TVR_SIZE) {
+        bucket = tv1 + (expires & TVR_MASK);
+    }
+    else {
+        if (idx > MAX_TVAL) {
+            expires = timer->expires = timer_jiffies + MAX_TVAL;
+        }
+        for (n = 0; n < TVN_LEVELS - 1 && idx >= (1UL << TVN_SHIFT(n + 1)); n ++)
+            /* nothing */ ;
+        bucket = tvn[n] + TVN_INDEX(n, expires);
+    }
+    list_add_before(bucket, &(timer->timer_link));
+}
+
+// apply_slack - the roundest tick in [expires, expires + slack]
+static size_t
+apply_slack(size_t expires, unsigned int slack) {
+    size_t limit = expires + slack, mask = expires ^ limit;
+    if (slack == 0 || mask == 0) {
+        return expires;
+    }
+    int bit = 0;
+    while ((mask >>= 1) != 0) {
+        bit ++;
+    }
+    return limit & ~((1UL << bit) - 1);
+}
+
+// add timer to timer_list
+void
+add_timer(timer_t *timer) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        assert(timer->expires > 0 && (timer->proc != NULL || timer->func != NULL));
+        assert(list_empty(&(timer->timer_link)));
+        // an expire time of 1 means the next tick
+        timer->expires = apply_slack(timer_jiffies - 1 + timer->expires, timer->slack);
+        internal_add_timer(timer);
+        // the wheel is run by the boot cpu, which may be idle with its tick stopped
+        clock_kick();
+    }
+    local_intr_restore(intr_flag);
+}
+
+// del timer from timer_list
+void
+del_timer(timer_t *timer) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (!list_empty(&(timer->timer_link))) {
+            list_del_init(&(timer->timer_link));
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+// cascade - re-hash the timers of bucket @index of level @n, return @index
+static int
+cascade(int n, int index) {
+    list_entry_t *bucket = tvn[n] + index, *le;
+    while ((le = list_next(bucket)) != bucket) {
+        list_del_init(le);
+        internal_add_timer(le2timer(le, timer_link));
+    }
+    return index;
+}
+
+static void
+timer_expire(timer_t *timer) {
+    if (timer->func != NULL) {
+        timer->func(timer->arg);
+        return;
+    }
+    struct proc_struct *proc = timer->proc;
+    if (proc->wait_state != 0) {
+        assert(proc->wait_state & WT_INTERRUPTED);
+    }
+    else {
+        warn("process %d's wait_state == 0.\n", proc->pid);
+    }
+    wakeup_proc(proc);
+}
+
+/* *
+ * timer_idle_ticks - how many ticks may pass before run_timers has to run
+ * again, at most @max_ticks: 1 if a timer expires on the next tick. A
+ * bucket of tvn counts from the tick it is cascaded, which is never later
+ * than the expiry of its timers.
+ * */
+unsigned int
+timer_idle_ticks(unsigned int max_ticks) {
+    size_t next = timer_jiffies + max_ticks - 1;
+    int i, n;
+    assert(max_ticks > 0);
+    for (i = 0; i < TVR_SIZE && timer_jiffies + i < next; i ++) {
+        if (!list_empty(tv1 + ((timer_jiffies + i) & TVR_MASK))) {
+            next = timer_jiffies + i;
+            break;
+        }
+    }
+    for (n = 0; n < TVN_LEVELS; n ++) {
+        size_t base = timer_jiffies >> TVN_SHIFT(n);
+        for (i = 0; i < TVN_SIZE; i ++) {
+            size_t cascade_tick = (base + i) << TVN_SHIFT(n);
+            if (cascade_tick < timer_jiffies) {
+                cascade_tick += (size_t)TVN_SIZE << TVN_SHIFT(n);
+            }
+            if (cascade_tick < next && !list_empty(tvn[n] + ((base + i) & TVN_MASK))) {
+                next = cascade_tick;
+            }
+        }
+    }
+    return next - timer_jiffies + 1;
+}
+
+/* *
+ * run_timers - process one tick: cascade if tv1 wrapped, then run the
+ * timers expiring now. Called from the timer interrupt, the callbacks run
+ * with interrupts disabled and may add or delete timers.
+ * */
+void
+run_timers(void) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        int index = timer_jiffies & TVR_MASK, n;
+        if (index == 0) {
+            for (n = 0; n < TVN_LEVELS && cascade(n, TVN_INDEX(n, timer_jiffies)) == 0; n ++)
+                /* nothing */ ;
+        }
+        timer_jiffies ++;
+
+        list_entry_t *bucket = tv1 + index, *le;
+        while ((le = list_next(bucket)) != bucket) {
+            timer_t *timer = le2timer(le, timer_link);
+            list_del_init(le);
+            timer_expire(timer);
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+#define CHECK_NR_TIMERS         4096
+
+static size_t check_fired;
+
+static void
+check_timer_func(void *arg) {
+    timer_t *timer = arg;
+    // the tick being processed is timer_jiffies - 1
+    assert(timer->expires == timer_jiffies - 1);
+    check_fired ++;
+}
+
+// check_timer - run thousands of timers with expiries up to all levels of the wheel through it
+static void
+check_timer(void) {
+    timer_t *timers;
+    size_t *want;
+    assert((timers = kmalloc(sizeof(timer_t) * CHECK_NR_TIMERS)) != NULL);
+    assert((want = kmalloc(sizeof(size_t) * CHECK_NR_TIMERS)) != NULL);
+
+    size_t start = timer_jiffies, end = 0;
+    unsigned int seed = 1, i, nr_deleted = 0;
+    check_fired = 0;
+    for (i = 0; i < CHECK_NR_TIMERS; i ++) {
+        seed = seed * 1103515245 + 12345;
+        // mostly short timeouts, some up to the second level of tvn
+        int expires = 1 + ((i % 8 == 0) ? seed % (1 << TVN_SHIFT(2)) : seed % (TVR_SIZE * 2));
+        timer_init_func(timers + i, check_timer_func, timers + i, expires);
+        if (i % 4 == 0) {
+            timer_set_slack(timers + i, expires / 16);
+        }
+        want[i] = start - 1 + expires;
+        add_timer(timers + i);
+        assert(timers[i].expires >= want[i] && timers[i].expires <= want[i] + timers[i].slack);
+        end = (timers[i].expires > end) ? timers[i].expires : end;
+    }
+    for (i = 0; i < CHECK_NR_TIMERS; i += 3) {
+        del_timer(timers + i);
+        assert(!timer_pending(timers + i));
+        nr_deleted ++;
+    }
+
+    while (timer_jiffies <= end) {
+        // an idle cpu sleeps through the first n - 1 ticks, no timer may expire in them
+        size_t fired = check_fired, n = timer_idle_ticks(MAX_TVAL);
+        while (-- n > 0) {
+            run_timers();
+            assert(check_fired == fired);
+        }
+        run_timers();
+    }
+    assert(timer_idle_ticks(100) == 100);
+    for (i = 0; i < CHECK_NR_TIMERS; i ++) {
+        assert(!timer_pending(timers + i));
+    }
+    assert(check_fired == CHECK_NR_TIMERS - nr_deleted);
+
+    kfree(want);
+    kfree(timers);
+    cprintf("check_timer() succeeded!\n");
+}
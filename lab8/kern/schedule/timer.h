@@ -0,0 +1,62 @@
+#ifndef __KERN_SCHEDULE_TIMER_H__
+#define __KERN_SCHEDULE_TIMER_H__
+
+#include <defs.h>
+#include <list.h>
+
+struct proc_struct;
+
+typedef struct {
+    size_t expires;             //the expire time, in ticks from now until add_timer, then the absolute tick
+    unsigned int slack;         //the timer may expire up to slack ticks late, so it can share a tick with others
+    struct proc_struct *proc;   //the proc wait in this timer. If the expire time is end, then this proc will be scheduled
+    void (*func)(void *arg);    //if not NULL, called with arg on expiry instead of waking up proc
+    void *arg;
+    list_entry_t timer_link;    //the timer list
+} timer_t;
+
+#define le2timer(le, member)            \
+to_struct((le), timer_t, member)
+
+// the default slack of a timer: 1/256 of its timeout, so short sleeps stay exact
+#define TIMER_DEFAULT_SLACK(expires)    ((expires) >> 8)
+
+// init a timer
+static inline timer_t *
+timer_init(timer_t *timer, struct proc_struct *proc, int expires) {
+    timer->expires = expires;
+    timer->slack = TIMER_DEFAULT_SLACK(expires);
+    timer->proc = proc;
+    timer->func = NULL;
+    timer->arg = NULL;
+    list_init(&(timer->timer_link));
+    return timer;
+}
+
+// init a timer that calls func(arg) from the timer interrupt when it expires
+static inline timer_t *
+timer_init_func(timer_t *timer, void (*func)(void *arg), void *arg, int expires) {
+    timer_init(timer, NULL, expires);
+    timer->func = func;
+    timer->arg = arg;
+    return timer;
+}
+
+static inline void
+timer_set_slack(timer_t *timer, unsigned int slack) {
+    timer->slack = slack;
+}
+
+static inline bool
+timer_pending(timer_t *timer) {
+    return !list_empty(&(timer->timer_link));
+}
+
+void timer_wheel_init(void);
+void add_timer(timer_t *timer);     // add timer to timer_list
+void del_timer(timer_t *timer);     // del timer from timer_list
+void run_timers(void);              // advance the timer wheel by one tick and run the expired timers
+unsigned int timer_idle_ticks(unsigned int max_ticks);
+
+#endif /* !__KERN_SCHEDULE_TIMER_H__ */
+
@@ -166,6 +166,7 @@ int philosopher_using_semaphore(void * arg) /* i：哲学家号码，从0到N-1
 struct proc_struct *philosopher_proc_condvar[N]; // N philosopher
 int state_condvar[N];                            // the philosopher's state: EATING, HUNGARY, THINKING  
 monitor_t mt, *mtp=&mt;                          // monitor
+int nr_signals_condvar;                          // the signals sent, in the monitor
 
 void phi_test_condvar (int i) { 
     if(state_condvar[i]==HUNGRY&&state_condvar[LEFT]!=EATING
@@ -173,36 +174,41 @@ void phi_test_condvar (int i) {
         cprintf("phi_test_condvar: state_condvar[%d] will eating\n",i);
         state_condvar[i] = EATING ;
         cprintf("phi_test_condvar: signal self_cv[%d] \n",i);
+        if (mtp->cv[i].count > 0) {
+            nr_signals_condvar ++;
+        }
         cond_signal(&mtp->cv[i]) ;
     }
 }
 
 
 void phi_take_forks_condvar(int i) {
-     down(&(mtp->mutex));
+     monitor_enter(mtp);
 //--------into routine in monitor--------------
-     // LAB7 EXERCISE2: YOUR CODE
      // I am hungry
-     // try to get fork
+     state_condvar[i]=HUNGRY;
+     // try to get fork, a neighbor puts us to EATING when it signals
+     phi_test_condvar(i);
+     // Hoare gives us the monitor with our state set, Mesa must look again
+     while(state_condvar[i]!=EATING) {
+         cprintf("phi_take_forks_condvar: %d didn't get fork and will wait\n",i);
+         cond_wait(&mtp->cv[i]);
+     }
 //--------leave routine in monitor--------------
-      if(mtp->next_count>0)
-         up(&(mtp->next));
-      else
-         up(&(mtp->mutex));
+     monitor_exit(mtp);
 }
 
 void phi_put_forks_condvar(int i) {
-     down(&(mtp->mutex));
+     monitor_enter(mtp);
 
 //--------into routine in monitor--------------
-     // LAB7 EXERCISE2: YOUR CODE
      // I ate over
+     state_condvar[i]=THINKING;
      // test left and right neighbors
+     phi_test_condvar(LEFT);
+     phi_test_condvar(RIGHT);
 //--------leave routine in monitor--------------
-     if(mtp->next_count>0)
-        up(&(mtp->next));
-     else
-        up(&(mtp->mutex));
+     monitor_exit(mtp);
 }
 
 //---------- philosophers using monitor (condition variable) ----------------------
@@ -226,12 +232,128 @@ int philosopher_using_condvar(void * arg) { /* arg is the No. of philosopher 0~N
     return 0;    
 }
 
+//---------- producer/consumer using monitor ----------------------
+#define NR_PRODUCERS 2
+#define NR_CONSUMERS 2
+#define NR_ITEMS 100 /* 每个生产者生产的数目 */
+#define BUFSIZE 4
+#define NOT_FULL 0 /* 条件变量：缓冲区不满 */
+#define NOT_EMPTY 1 /* 条件变量：缓冲区不空 */
+
+monitor_t pc_mt;
+int pc_buf[BUFSIZE], pc_head, pc_count; /* 环形缓冲区 */
+int nr_producing, nr_consumed;
+long pc_sum;
+
+int producer_using_condvar(void * arg) {
+    int i, base = (long)arg * NR_ITEMS;
+    for (i = 1; i <= NR_ITEMS; i ++) {
+        monitor_enter(&pc_mt);
+        while (pc_count == BUFSIZE) {
+            cond_wait(&pc_mt.cv[NOT_FULL]);
+        }
+        pc_buf[(pc_head + pc_count) % BUFSIZE] = base + i;
+        pc_count ++;
+        cond_signal(&pc_mt.cv[NOT_EMPTY]);
+        monitor_exit(&pc_mt);
+    }
+    // the last producer lets every waiting consumer see that it is over
+    monitor_enter(&pc_mt);
+    if (-- nr_producing == 0) {
+        cond_broadcast(&pc_mt.cv[NOT_EMPTY]);
+    }
+    monitor_exit(&pc_mt);
+    return 0;
+}
+
+int consumer_using_condvar(void * arg) {
+    while (1) {
+        monitor_enter(&pc_mt);
+        while (pc_count == 0 && nr_producing > 0) {
+            cond_wait(&pc_mt.cv[NOT_EMPTY]);
+        }
+        if (pc_count == 0) {
+            monitor_exit(&pc_mt);
+            return 0;
+        }
+        pc_sum += pc_buf[pc_head];
+        pc_head = (pc_head + 1) % BUFSIZE;
+        pc_count --, nr_consumed ++;
+        cond_signal(&pc_mt.cv[NOT_FULL]);
+        monitor_exit(&pc_mt);
+    }
+}
+
+// nr_child_switches - the context switches of the reaped children of current
+static uint64_t nr_child_switches(void) {
+    return current->cacct.nvcsw + current->cacct.nivcsw;
+}
+
+static const char *mode_name(int mode) {
+    return (mode == MONITOR_MESA) ? "mesa" : "hoare";
+}
+
+void check_philosopher_condvar(int mode) {
+    int i, pids[N];
+    uint64_t switches = nr_child_switches();
+    monitor_init_mode(&mt, N, mode);
+    monitor_set_class(&mt, "philosopher_mon");
+    nr_signals_condvar = 0;
+    for(i=0;i<N;i++){
+        state_condvar[i]=THINKING;
+        int pid = kernel_thread(philosopher_using_condvar, (void *)i, 0);
+        if (pid <= 0) {
+            panic("create No.%d philosopher_using_condvar failed.\n");
+        }
+        pids[i] = pid;
+        philosopher_proc_condvar[i] = find_proc(pid);
+        set_proc_name(philosopher_proc_condvar[i], "philosopher_condvar_proc");
+    }
+    for (i=0;i<N;i++)
+        assert(do_wait(pids[i],NULL) == 0);
+    monitor_free(&mt, N);
+    // each philosopher also sleeps twice an iteration, and exits
+    switches = nr_child_switches() - switches - (2 * TIMES + 1) * N;
+    cprintf("check_sync: %s philosophers: %d signals, %d context switches besides sleeps\n",
+            mode_name(mode), nr_signals_condvar, (int)switches);
+}
+
+void check_producer_consumer(int mode) {
+    int i, pids[NR_PRODUCERS + NR_CONSUMERS], nr_items = NR_PRODUCERS * NR_ITEMS;
+    uint64_t switches = nr_child_switches();
+    monitor_init_mode(&pc_mt, 2, mode);
+    monitor_set_class(&pc_mt, "pc_mon");
+    pc_head = pc_count = nr_consumed = 0, pc_sum = 0;
+    nr_producing = NR_PRODUCERS;
+    for (i = 0; i < NR_PRODUCERS + NR_CONSUMERS; i ++) {
+        if (i < NR_PRODUCERS) {
+            pids[i] = kernel_thread(producer_using_condvar, (void *)(long)i, 0);
+        }
+        else {
+            pids[i] = kernel_thread(consumer_using_condvar, NULL, 0);
+        }
+        assert(pids[i] > 0);
+    }
+    for (i = 0; i < NR_PRODUCERS + NR_CONSUMERS; i ++) {
+        assert(do_wait(pids[i], NULL) == 0);
+    }
+    assert(nr_consumed == nr_items && pc_sum == (long)nr_items * (nr_items + 1) / 2);
+    assert(pc_count == 0 && pc_mt.cv[NOT_EMPTY].count == 0 && pc_mt.cv[NOT_FULL].count == 0);
+    monitor_free(&pc_mt, 2);
+    // not counting the switch of every thread on exit
+    switches = nr_child_switches() - switches - (NR_PRODUCERS + NR_CONSUMERS);
+    cprintf("check_sync: %s producer/consumer: %d items, %d context switches, %d.%02d per item\n",
+            mode_name(mode), nr_items, (int)switches, (int)(switches / nr_items),
+            (int)(switches * 100 / nr_items % 100));
+}
+
 void check_sync(void){
 
     int i, pids[N];
 
     //check semaphore
     sem_init(&mutex, 1);
+    lockstat_set_class(&mutex, "philosopher_sem");
     for(i=0;i<N;i++){
         sem_init(&s[i], 0);
         int pid = kernel_thread(philosopher_using_semaphore, (void *)i, 0);
@@ -245,19 +367,11 @@ void check_sync(void){
     for (i=0;i<N;i++)
         assert(do_wait(pids[i],NULL) == 0);
 
-    //check condition variable
-    monitor_init(&mt, N);
-    for(i=0;i<N;i++){
-        state_condvar[i]=THINKING;
-        int pid = kernel_thread(philosopher_using_condvar, (void *)i, 0);
-        if (pid <= 0) {
-            panic("create No.%d philosopher_using_condvar failed.\n");
-        }
-        pids[i] = pid;
-        philosopher_proc_condvar[i] = find_proc(pid);
-        set_proc_name(philosopher_proc_condvar[i], "philosopher_condvar_proc");
-    }
-    for (i=0;i<N;i++)
-        assert(do_wait(pids[i],NULL) == 0);
-    monitor_free(&mt, N);
+    //check condition variable, both semantics
+    check_philosopher_condvar(MONITOR_HOARE);
+    check_philosopher_condvar(MONITOR_MESA);
+    check_producer_consumer(MONITOR_HOARE);
+    check_producer_consumer(MONITOR_MESA);
+
+    cprintf("check_sync() succeeded!\n");
 }
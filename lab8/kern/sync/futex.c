@@ -0,0 +1,149 @@
+#include <defs.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <error.h>
+#include <sync.h>
+#include <wait.h>
+#include <mmu.h>
+#include <pmm.h>
+#include <vmm.h>
+#include <proc.h>
+#include <sched.h>
+#include <assert.h>
+#include <futex.h>
+
+/* *
+ * Futexes - fast user-space mutexes
+ *
+ * User space takes an uncontended lock with an atomic instruction alone,
+ * and only makes a system call to sleep on a word when it must wait, or to
+ * wake the sleepers of a word it released. A futex is known by the
+ * physical address of its word, so the threads of a process, and anyone
+ * else mapping the page, meet on the same futex.
+ *
+ * Waiters sleep on one of FUTEX_HASH_SIZE wait queues chosen by hashing
+ * that address. FUTEX_WAIT checks the word and queues current in one go
+ * under the kernel lock, and a waker must take that lock too, so a wakeup
+ * cannot slip in between.
+ * */
+
+#define FUTEX_HASH_SHIFT            6
+#define FUTEX_HASH_SIZE             (1 << FUTEX_HASH_SHIFT)
+
+// a sleeper on a futex
+struct futex_waiter {
+    wait_t wait;
+    uintptr_t key;                  // the physical address of the word
+};
+
+#define le2waiter(le)               to_struct(le2wait(le, wait_link), struct futex_waiter, wait)
+
+static wait_queue_t futex_queues[FUTEX_HASH_SIZE];
+
+void
+futex_init(void) {
+    int i;
+    for (i = 0; i < FUTEX_HASH_SIZE; i ++) {
+        wait_queue_init(futex_queues + i);
+    }
+}
+
+static inline wait_queue_t *
+futex_queue(uintptr_t key) {
+    return futex_queues + hash32((uint32_t)(key >> 2), FUTEX_HASH_SHIFT);
+}
+
+/* *
+ * futex_key - read the word at @uaddr into @val and find its physical
+ * address. Reading it faults the page in if it is not present.
+ * */
+static int
+futex_key(uintptr_t uaddr, int *val, uintptr_t *key) {
+    struct mm_struct *mm = current->mm;
+    int ret = -E_FAULT;
+    if (mm == NULL || uaddr % sizeof(int) != 0) {
+        return -E_INVAL;
+    }
+    lock_mm_read(mm);
+    if (copy_from_user(mm, val, (int *)uaddr, sizeof(int), 1)) {
+        pte_t *ptep = get_pte(mm->pgdir, uaddr, 0);
+        if (ptep != NULL && (*ptep & PTE_V)) {
+            *key = PTE_ADDR(*ptep) | (uaddr & (PGSIZE - 1));
+            ret = 0;
+        }
+    }
+    unlock_mm_read(mm);
+    return ret;
+}
+
+// futex_wait - sleep on the futex at @uaddr if it still holds @val
+static int
+futex_wait(uintptr_t uaddr, int val) {
+    struct futex_waiter waiter;
+    uintptr_t key;
+    int ret, cur;
+    if ((ret = futex_key(uaddr, &cur, &key)) != 0) {
+        return ret;
+    }
+    if (cur != val) {
+        return -E_AGAIN;
+    }
+
+    wait_queue_t *queue = futex_queue(key);
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    waiter.key = key;
+    wait_current_set(queue, &(waiter.wait), WT_FUTEX);
+    local_intr_restore(intr_flag);
+
+    schedule();
+
+    local_intr_save(intr_flag);
+    wait_current_del(queue, &(waiter.wait));
+    local_intr_restore(intr_flag);
+
+    if (waiter.wait.wakeup_flags != WT_FUTEX) {
+        return -E_KILLED;
+    }
+    return 0;
+}
+
+// futex_wake - wake up at most @nr sleepers on the futex at @uaddr, return how many
+static int
+futex_wake(uintptr_t uaddr, int nr) {
+    uintptr_t key;
+    int ret, cur;
+    if ((ret = futex_key(uaddr, &cur, &key)) != 0) {
+        return ret;
+    }
+
+    wait_queue_t *queue = futex_queue(key);
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *le = list_next(&(queue->wait_head));
+        while (ret < nr && le != &(queue->wait_head)) {
+            struct futex_waiter *waiter = le2waiter(le);
+            le = list_next(le);
+            if (waiter->key == key) {
+                wakeup_wait(queue, &(waiter->wait), WT_FUTEX, 1);
+                ret ++;
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+    return ret;
+}
+
+// do_futex - called by sys_futex
+int
+do_futex(uintptr_t uaddr, int op, int val) {
+    switch (op) {
+    case FUTEX_WAIT:
+        return futex_wait(uaddr, val);
+    case FUTEX_WAKE:
+        return futex_wake(uaddr, val);
+    }
+    return -E_INVAL;
+}
+
@@ -0,0 +1,114 @@
+#include <defs.h>
+#include <list.h>
+#include <sync.h>
+#include <stdio.h>
+#include <string.h>
+#include <kmalloc.h>
+#include <lockstat.h>
+
+/* *
+ * Lock contention statistics
+ *
+ * The counters are changed by kernel code only, under the kernel lock,
+ * and never by interrupt handlers, so they are plain increments. A
+ * monitor passed to a signalled process without its mutex being taken
+ * again counts as held only until its first release.
+ * */
+
+#define LOCKSTAT_LINELEN            96
+
+static list_entry_t lock_class_list = {&lock_class_list, &lock_class_list};
+
+#ifdef LOCKSTAT
+
+void
+lockstat_register(lockstat_t *ls, lock_class_t *class) {
+    if (class->class_link.next == NULL) {
+        list_add_before(&lock_class_list, &(class->class_link));
+    }
+    ls->class = class;
+    ls->hold_start = 0;
+}
+
+void
+lockstat_account_acquired(lockstat_t *ls, uint64_t wait_start, bool exclusive) {
+    lock_class_t *class = ls->class;
+    uint64_t now = get_cycles();
+    class->nr_acquired ++;
+    if (wait_start != 0) {
+        uint64_t wait = now - wait_start;
+        class->nr_contended ++;
+        class->wait_total += wait;
+        if (class->wait_max < wait) {
+            class->wait_max = wait;
+        }
+    }
+    if (exclusive) {
+        ls->hold_start = now;
+    }
+}
+
+void
+lockstat_account_released(lockstat_t *ls) {
+    lock_class_t *class = ls->class;
+    if (ls->hold_start != 0) {
+        uint64_t hold = get_cycles() - ls->hold_start;
+        class->hold_total += hold;
+        if (class->hold_max < hold) {
+            class->hold_max = hold;
+        }
+        ls->hold_start = 0;
+    }
+}
+
+#endif /* LOCKSTAT */
+
+// lockstat_snprint - write the statistics of every lock class to @buf as text, return the length
+size_t
+lockstat_snprint(char *buf, size_t size) {
+    size_t len = 0;
+#ifdef LOCKSTAT
+    len += snprintf(buf, size, "%-16s %10s %10s %12s %10s %12s %10s\n", "class", "acquired",
+                    "contended", "wait-total", "wait-max", "hold-total", "hold-max");
+    list_entry_t *le = &lock_class_list;
+    while ((le = list_next(le)) != &lock_class_list && len < size) {
+        lock_class_t *class = to_struct(le, lock_class_t, class_link);
+        len += snprintf(buf + len, size - len, "%-16s %10ld %10ld %12ld %10ld %12ld %10ld\n",
+                        class->name, class->nr_acquired, class->nr_contended, class->wait_total,
+                        class->wait_max, class->hold_total, class->hold_max);
+    }
+#else
+    len += snprintf(buf, size, "lockstat is not built in, build with make LOCKSTAT=1.\n");
+#endif
+    return (len < size) ? len : size - 1;
+}
+
+void
+lockstat_print(void) {
+    size_t size = LOCKSTAT_LINELEN;
+    list_entry_t *le = &lock_class_list;
+    while ((le = list_next(le)) != &lock_class_list) {
+        size += LOCKSTAT_LINELEN;
+    }
+    char *buf;
+    if ((buf = kmalloc(size)) == NULL) {
+        cprintf("lockstat: no memory.\n");
+        return;
+    }
+    lockstat_snprint(buf, size);
+    cprintf("%s", buf);
+    kfree(buf);
+}
+
+// lockstat_reset - zero the counters of every lock class, the classes stay registered
+void
+lockstat_reset(void) {
+    list_entry_t *le = &lock_class_list;
+    while ((le = list_next(le)) != &lock_class_list) {
+        lock_class_t *class = to_struct(le, lock_class_t, class_link);
+        class->nr_acquired = class->nr_contended = 0;
+        class->wait_total = class->wait_max = 0;
+        class->hold_total = class->hold_max = 0;
+    }
+}
+
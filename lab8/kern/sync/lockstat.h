@@ -0,0 +1,97 @@
+#ifndef __KERN_SYNC_LOCKSTAT_H__
+#define __KERN_SYNC_LOCKSTAT_H__
+
+#include <defs.h>
+#include <list.h>
+#include <clock.h>
+
+/* *
+ * lockstat - contention statistics of the kernel locks, built in with
+ * make LOCKSTAT=1. A lock is counted once lockstat_set_class names its
+ * class, and all the locks of a class (the io_mutex of every sfs, the
+ * mm_rwsem of every mm) add to the same counters. Times are in timer
+ * cycles (rdtime). Without LOCKSTAT the hooks compile to nothing.
+ * */
+typedef struct lock_class {
+    const char *name;
+    uint64_t nr_acquired;           // acquisitions
+    uint64_t nr_contended;          // acquisitions that had to wait
+    uint64_t wait_total, wait_max;  // time from the first try to getting it
+    uint64_t hold_total, hold_max;  // time held, exclusive holders only
+    list_entry_t class_link;        // entry in the class list, NULL until registered
+} lock_class_t;
+
+#ifdef LOCKSTAT
+
+typedef struct lockstat {
+    lock_class_t *class;            // NULL if not counted
+    uint64_t hold_start;            // when the exclusive holder got it, 0 if none
+} lockstat_t;
+
+void lockstat_register(lockstat_t *ls, lock_class_t *class);
+void lockstat_account_acquired(lockstat_t *ls, uint64_t wait_start, bool exclusive);
+void lockstat_account_released(lockstat_t *ls);
+
+// lockstat_set_class - count @lock (anything with a lockstat_t stat) as class @class_name
+#define lockstat_set_class(lock, class_name)                            \
+    do {                                                                \
+        static lock_class_t __class = {.name = (class_name)};           \
+        lockstat_register(&((lock)->stat), &__class);                   \
+    } while (0)
+
+static inline void
+lockstat_init(lockstat_t *ls) {
+    ls->class = NULL;
+    ls->hold_start = 0;
+}
+
+// lockstat_wait_start - the lock is contended, the time the wait starts
+static inline uint64_t
+lockstat_wait_start(lockstat_t *ls) {
+    return (ls->class != NULL) ? get_cycles() : 0;
+}
+
+// lockstat_acquired - got the lock exclusively, after waiting since @wait_start if not 0
+static inline void
+lockstat_acquired(lockstat_t *ls, uint64_t wait_start) {
+    if (ls->class != NULL) {
+        lockstat_account_acquired(ls, wait_start, 1);
+    }
+}
+
+// lockstat_acquired_shared - got the lock shared, the hold time is not measured
+static inline void
+lockstat_acquired_shared(lockstat_t *ls, uint64_t wait_start) {
+    if (ls->class != NULL) {
+        lockstat_account_acquired(ls, wait_start, 0);
+    }
+}
+
+static inline void
+lockstat_released(lockstat_t *ls) {
+    if (ls->class != NULL) {
+        lockstat_account_released(ls);
+    }
+}
+
+#else /* !LOCKSTAT */
+
+typedef struct lockstat {
+} lockstat_t;
+
+#define lockstat_set_class(lock, class_name)        do { } while (0)
+
+static inline void lockstat_init(lockstat_t *ls) {}
+static inline uint64_t lockstat_wait_start(lockstat_t *ls) { return 0; }
+static inline void lockstat_acquired(lockstat_t *ls, uint64_t wait_start) {}
+static inline void lockstat_acquired_shared(lockstat_t *ls, uint64_t wait_start) {}
+static inline void lockstat_released(lockstat_t *ls) {}
+
+#endif /* LOCKSTAT */
+
+size_t lockstat_snprint(char *buf, size_t size);
+void lockstat_print(void);
+void lockstat_reset(void);
+
+#endif /* !__KERN_SYNC_LOCKSTAT_H__ */
+
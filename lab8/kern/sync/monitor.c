@@ -4,11 +4,13 @@
 #include <assert.h>
 
 
-// Initialize monitor.
-void     
-monitor_init (monitor_t * mtp, size_t num_cv) {
+// Initialize monitor with signal semantics mode, MONITOR_HOARE or MONITOR_MESA.
+void
+monitor_init_mode (monitor_t * mtp, size_t num_cv, int mode) {
     int i;
     assert(num_cv>0);
+    assert(mode == MONITOR_HOARE || mode == MONITOR_MESA);
+    mtp->mode = mode;
     mtp->next_count = 0;
     mtp->cv = NULL;
     sem_init(&(mtp->mutex), 1); //unlocked
@@ -22,17 +24,42 @@ monitor_init (monitor_t * mtp, size_t num_cv) {
     }
 }
 
+// Initialize monitor with Hoare semantics.
+void
+monitor_init (monitor_t * mtp, size_t num_cv) {
+    monitor_init_mode(mtp, num_cv, MONITOR_HOARE);
+}
+
 // Free monitor.
 void
 monitor_free (monitor_t * mtp, size_t num_cv) {
     kfree(mtp->cv);
 }
 
-// Unlock one of threads waiting on the condition variable. 
-void 
+// Enter the monitor.
+void
+monitor_enter (monitor_t * mtp) {
+    down(&(mtp->mutex));
+}
+
+// Leave the monitor, to a signaller waiting to come back in if there is one (Hoare).
+void
+monitor_exit (monitor_t * mtp) {
+    if (mtp->next_count > 0) {
+        up(&(mtp->next));
+    }
+    else {
+        up(&(mtp->mutex));
+    }
+}
+
+// Unlock one of threads waiting on the condition variable.
+// Hoare: the waiter runs at once in the monitor, the signaller waits on next until it leaves.
+// Mesa: the waiter is only woken, it takes the monitor again when the signaller leaves,
+// and must check its condition again.
+void
 cond_signal (condvar_t *cvp) {
-   //LAB7 EXERCISE2: YOUR CODE
-   cprintf("cond_signal begin: cvp %x, cvp->count %d, cvp->owner->next_count %d\n", cvp, cvp->count, cvp->owner->next_count);  
+   monitor_t *mtp = cvp->owner;
   /*
    *      cond_signal(cv) {
    *          if(cv.count>0) {
@@ -43,16 +70,43 @@ cond_signal (condvar_t *cvp) {
    *          }
    *       }
    */
-  
-   cprintf("cond_signal end: cvp %x, cvp->count %d, cvp->owner->next_count %d\n", cvp, cvp->count, cvp->owner->next_count);
+   if (cvp->count > 0) {
+       if (mtp->mode == MONITOR_MESA) {
+           cvp->count --;
+           up(&(cvp->sem));
+           return;
+       }
+       mtp->next_count ++;
+       up(&(cvp->sem));
+       down(&(mtp->next));
+       mtp->next_count --;
+   }
+}
+
+// Unlock all threads waiting on the condition variable. With Hoare semantics
+// each of them runs in the monitor in turn before the broadcaster goes on.
+void
+cond_broadcast (condvar_t *cvp) {
+    monitor_t *mtp = cvp->owner;
+    if (mtp->mode == MONITOR_MESA) {
+        while (cvp->count > 0) {
+            cvp->count --;
+            up(&(cvp->sem));
+        }
+        return;
+    }
+    int count = cvp->count;
+    // who wakes up may wait on cvp again, do not signal it twice
+    while (count -- > 0 && cvp->count > 0) {
+        cond_signal(cvp);
+    }
 }
 
-// Suspend calling thread on a condition variable waiting for condition Atomically unlocks 
+// Suspend calling thread on a condition variable waiting for condition Atomically unlocks
 // mutex and suspends calling thread on conditional variable after waking up locks mutex. Notice: mp is mutex semaphore for monitor's procedures
 void
 cond_wait (condvar_t *cvp) {
-    //LAB7 EXERCISE2: YOUR CODE
-    cprintf("cond_wait begin:  cvp %x, cvp->count %d, cvp->owner->next_count %d\n", cvp, cvp->count, cvp->owner->next_count);
+    monitor_t *mtp = cvp->owner;
    /*
     *         cv.count ++;
     *         if(mt.next_count>0)
@@ -62,5 +116,13 @@ cond_wait (condvar_t *cvp) {
     *         wait(cv.sem);
     *         cv.count --;
     */
-    cprintf("cond_wait end:  cvp %x, cvp->count %d, cvp->owner->next_count %d\n", cvp, cvp->count, cvp->owner->next_count);
+    cvp->count ++;
+    monitor_exit(mtp);
+    down(&(cvp->sem));
+    if (mtp->mode == MONITOR_MESA) {
+        // the signaller took us off count, the monitor is not handed over
+        monitor_enter(mtp);
+        return;
+    }
+    cvp->count --;
 }
@@ -72,21 +72,35 @@ typedef struct condvar{
     monitor_t * owner;      // the owner(monitor) of this condvar
 } condvar_t;
 
+#define MONITOR_HOARE   0       // signal hands the monitor to the waiter, the signaller waits on next
+#define MONITOR_MESA    1       // signal only wakes the waiter, which checks its condition again
+
 typedef struct monitor{
+    int mode;               // MONITOR_HOARE or MONITOR_MESA
     semaphore_t mutex;      // the mutex lock for going into the routines in monitor, should be initialized to 1
     semaphore_t next;       // the next semaphore is used to down the signaling proc itself, and the other OR wakeuped waiting proc should wake up the sleeped signaling proc.
     int next_count;         // the number of of sleeped signaling proc
     condvar_t *cv;          // the condvars in monitor
 } monitor_t;
 
-// Initialize variables in monitor.
+// Initialize variables in monitor, with Hoare semantics.
 void     monitor_init (monitor_t *cvp, size_t num_cv);
+// Initialize variables in monitor, with the semantics of mode.
+void     monitor_init_mode (monitor_t *cvp, size_t num_cv, int mode);
 // Free variables in monitor.
 void     monitor_free (monitor_t *cvp, size_t num_cv);
+// Enter a routine in the monitor.
+void     monitor_enter (monitor_t *mtp);
+// Leave a routine in the monitor.
+void     monitor_exit (monitor_t *mtp);
 // Unlock one of threads waiting on the condition variable.
 void     cond_signal (condvar_t *cvp);
+// Unlock all threads waiting on the condition variable.
+void     cond_broadcast (condvar_t *cvp);
 // Suspend calling thread on a condition variable waiting for condition atomically unlock mutex in monitor,
 // and suspends calling thread on conditional variable after waking up locks mutex.
 void     cond_wait (condvar_t *cvp);
+// Count the monitor, entered through its mutex, as lock class name in lockstat.
+#define  monitor_set_class(mtp, name)    lockstat_set_class(&((mtp)->mutex), name)
      
 #endif /* !__KERN_SYNC_MONITOR_CONDVAR_H__ */
@@ -0,0 +1,272 @@
+#include <defs.h>
+#include <list.h>
+#include <wait.h>
+#include <sync.h>
+#include <proc.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <assert.h>
+#include <atomic.h>
+#include <mutex.h>
+
+/* *
+ * Kernel mutexes with priority inheritance
+ *
+ * A semaphore used as a lock does not know who holds it, so a high
+ * priority process waiting for it can be kept waiting by anyone who runs
+ * before the low priority holder, for as long as they like. A mutex keeps
+ * its owner, and the owner runs with the highest policy and priority of
+ * the waiters of all the mutexes it holds (sched_pi_inherit). When the
+ * owner waits for another mutex itself, the priority is passed on down
+ * the chain, up to MUTEX_PI_MAX_DEPTH owners.
+ *
+ * mutex_unlock hands the mutex to its highest priority waiter, which then
+ * inherits from the waiters that are left. Taking and releasing a mutex
+ * nobody waits for is a compare-exchange each; only waiting and handing
+ * over disable interrupts.
+ * */
+
+#define MUTEX_PI_MAX_DEPTH          8
+
+void
+mutex_init(mutex_t *mutex) {
+    mutex->owner = 0;
+    list_init(&(mutex->owner_link));
+    wait_queue_init(&(mutex->wait_queue));
+    lockstat_init(&(mutex->stat));
+}
+
+// mutex_top_waiter - the waiter of @mutex with the highest priority, the first of equals
+static wait_t *
+mutex_top_waiter(mutex_t *mutex) {
+    wait_t *wait, *top = NULL;
+    for (wait = wait_queue_first(&(mutex->wait_queue)); wait != NULL;
+            wait = wait_queue_next(&(mutex->wait_queue), wait)) {
+        if (top == NULL || sched_prio_higher(wait->proc, top->proc)) {
+            top = wait;
+        }
+    }
+    return top;
+}
+
+// mutex_pi_donor - the process @proc inherits its priority from, NULL if none
+static struct proc_struct *
+mutex_pi_donor(struct proc_struct *proc) {
+    struct proc_struct *donor = NULL;
+    list_entry_t *list = &(proc->pi_mutexes), *le = list;
+    while ((le = list_next(le)) != list) {
+        wait_t *top = mutex_top_waiter(le2mutex(le, owner_link));
+        if (top != NULL && (donor == NULL || sched_prio_higher(top->proc, donor))) {
+            donor = top->proc;
+        }
+    }
+    return donor;
+}
+
+/* *
+ * mutex_pi_update - the waiters of the mutexes of @proc or its own priority
+ * changed: recompute what it inherits, and what the owners of the mutexes
+ * it waits for inherit in turn. Called with interrupts disabled.
+ * */
+void
+mutex_pi_update(struct proc_struct *proc) {
+    int depth;
+    for (depth = 0; proc != NULL && depth < MUTEX_PI_MAX_DEPTH; depth ++) {
+        sched_pi_inherit(proc, mutex_pi_donor(proc));
+        proc = (proc->pi_blocked_on != NULL) ? mutex_owner(proc->pi_blocked_on) : NULL;
+    }
+}
+
+static __noinline void
+mutex_lock_slow(mutex_t *mutex) {
+    bool intr_flag;
+    long owner;
+    uint64_t wait_start = lockstat_wait_start(&(mutex->stat));
+    local_intr_save(intr_flag);
+    // mark it, so that the owner's unlock takes the slow path and hands it over
+    while (!((owner = mutex->owner) & MUTEX_WAITERS)) {
+        if (owner == 0) {
+            if (atomic_long_cmpxchg_acquire(&(mutex->owner), 0, (long)current) == 0) {
+                list_add(&(current->pi_mutexes), &(mutex->owner_link));
+                local_intr_restore(intr_flag);
+                lockstat_acquired(&(mutex->stat), wait_start);
+                return;
+            }
+        }
+        else if (atomic_long_cmpxchg(&(mutex->owner), owner, owner | MUTEX_WAITERS) == owner) {
+            break;
+        }
+    }
+    assert(mutex_owner(mutex) != current);
+    wait_t __wait, *wait = &__wait;
+    wait_current_set(&(mutex->wait_queue), wait, WT_KMUTEX);
+    current->pi_blocked_on = mutex;
+    mutex_pi_update(mutex_owner(mutex));
+    local_intr_restore(intr_flag);
+
+    schedule();
+
+    local_intr_save(intr_flag);
+    wait_current_del(&(mutex->wait_queue), wait);
+    assert(mutex_owner(mutex) == current && current->pi_blocked_on == NULL);
+    local_intr_restore(intr_flag);
+    lockstat_acquired(&(mutex->stat), wait_start);
+}
+
+/* *
+ * mutex_lock - an unlocked mutex is taken with one compare-exchange, and
+ * unlocked with another if nobody waits. current->pi_mutexes is only
+ * walked under the kernel lock and never by an interrupt handler, so it
+ * is changed without disabling interrupts.
+ * */
+void
+mutex_lock(mutex_t *mutex) {
+    if (atomic_long_cmpxchg_acquire(&(mutex->owner), 0, (long)current) == 0) {
+        list_add(&(current->pi_mutexes), &(mutex->owner_link));
+        lockstat_acquired(&(mutex->stat), 0);
+        return;
+    }
+    mutex_lock_slow(mutex);
+}
+
+bool
+mutex_trylock(mutex_t *mutex) {
+    if (atomic_long_cmpxchg_acquire(&(mutex->owner), 0, (long)current) == 0) {
+        list_add(&(current->pi_mutexes), &(mutex->owner_link));
+        lockstat_acquired(&(mutex->stat), 0);
+        return 1;
+    }
+    return 0;
+}
+
+// mutex_unlock_slow - hand @mutex to its highest priority waiter
+static __noinline void
+mutex_unlock_slow(mutex_t *mutex) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        wait_t *wait = mutex_top_waiter(mutex);
+        assert(wait != NULL);
+        struct proc_struct *proc = wait->proc;
+        assert(proc->wait_state == WT_KMUTEX && proc->pi_blocked_on == mutex);
+        proc->pi_blocked_on = NULL;
+        wakeup_wait(&(mutex->wait_queue), wait, WT_KMUTEX, 1);
+        long owner = (long)proc | (wait_queue_empty(&(mutex->wait_queue)) ? 0 : MUTEX_WAITERS);
+        atomic_long_xchg_release(&(mutex->owner), owner);
+        list_add(&(proc->pi_mutexes), &(mutex->owner_link));
+        mutex_pi_update(proc);
+        mutex_pi_update(current);
+    }
+    local_intr_restore(intr_flag);
+}
+
+void
+mutex_unlock(mutex_t *mutex) {
+    assert(mutex_owner(mutex) == current);
+    lockstat_released(&(mutex->stat));
+    list_del_init(&(mutex->owner_link));
+    if (atomic_long_cmpxchg_release(&(mutex->owner), (long)current, 0) != (long)current) {
+        mutex_unlock_slow(mutex);
+    }
+}
+
+/* *
+ * check_mutex - priority inversion. current holds m1; a normal thread
+ * takes m2 and waits for m1, then a SCHED_FIFO thread of high priority
+ * waits for m2. current must run at the high priority through the chain,
+ * so a SCHED_FIFO thread of medium priority must not run before the high
+ * one got its mutex. It runs as init before any user process.
+ * */
+
+#define CHECK_PRIO_HIGH             20
+#define CHECK_PRIO_MEDIUM           10
+
+static mutex_t check_m1, check_m2;
+static char check_log[4];
+static int check_nlog;
+
+static void
+check_mutex_log(char c) {
+    assert(check_nlog < sizeof(check_log) - 1);
+    check_log[check_nlog ++] = c;
+}
+
+static int
+check_mutex_chain(void *arg) {
+    mutex_lock(&check_m2);
+    mutex_lock(&check_m1);
+    mutex_unlock(&check_m1);
+    mutex_unlock(&check_m2);
+    return 0;
+}
+
+static int
+check_mutex_high(void *arg) {
+    mutex_lock(&check_m2);
+    check_mutex_log('H');
+    mutex_unlock(&check_m2);
+    return 0;
+}
+
+static int
+check_mutex_medium(void *arg) {
+    check_mutex_log('M');
+    return 0;
+}
+
+// check_mutex_start - start a kernel thread with @policy and @priority
+static struct proc_struct *
+check_mutex_start(int (*fn)(void *), int policy, int priority) {
+    int pid;
+    struct proc_struct *proc;
+    assert((pid = kernel_thread(fn, NULL, 0)) > 0 && (proc = find_proc(pid)) != NULL);
+    assert(sched_setscheduler(proc, policy, priority) == 0);
+    return proc;
+}
+
+void
+check_mutex(void) {
+    struct proc_struct *chain, *high, *medium;
+    int policy = current->sched_policy, rt_priority = current->rt_priority;
+    assert(current->pi_blocked_on == NULL && list_empty(&(current->pi_mutexes)));
+
+    mutex_init(&check_m1);
+    mutex_init(&check_m2);
+    assert(mutex_trylock(&check_m1) && !mutex_trylock(&check_m1));
+    mutex_unlock(&check_m1);
+    assert(!mutex_locked(&check_m1));
+
+    check_nlog = 0;
+    mutex_lock(&check_m1);
+    chain = check_mutex_start(check_mutex_chain, SCHED_NORMAL, 0);
+    while (chain->pi_blocked_on != &check_m1) {
+        do_sleep(1);
+    }
+    high = check_mutex_start(check_mutex_high, SCHED_FIFO, CHECK_PRIO_HIGH);
+    while (high->pi_blocked_on != &check_m2) {
+        do_sleep(1);
+    }
+    assert(chain->sched_policy == SCHED_FIFO && chain->rt_priority == CHECK_PRIO_HIGH);
+    assert(current->sched_policy == SCHED_FIFO && current->rt_priority == CHECK_PRIO_HIGH);
+
+    // the holder of m1 must not be preempted by medium
+    medium = check_mutex_start(check_mutex_medium, SCHED_FIFO, CHECK_PRIO_MEDIUM);
+    schedule();
+    assert(check_nlog == 0);
+
+    mutex_unlock(&check_m1);
+    assert(current->sched_policy == policy && current->rt_priority == rt_priority);
+    assert(list_empty(&(current->pi_mutexes)));
+
+    assert(do_wait(chain->pid, NULL) == 0);
+    assert(do_wait(high->pid, NULL) == 0);
+    assert(do_wait(medium->pid, NULL) == 0);
+    assert(check_nlog == 2);
+    // with more cpus medium may run elsewhere once current sleeps
+    assert(ncpu > 1 || (check_log[0] == 'H' && check_log[1] == 'M'));
+    assert(!mutex_locked(&check_m1) && !mutex_locked(&check_m2));
+
+    cprintf("check_mutex() succeeded!\n");
+}
+
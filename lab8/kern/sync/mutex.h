@@ -0,0 +1,45 @@
+#ifndef __KERN_SYNC_MUTEX_H__
+#define __KERN_SYNC_MUTEX_H__
+
+#include <defs.h>
+#include <list.h>
+#include <wait.h>
+#include <lockstat.h>
+
+struct proc_struct;
+
+/* *
+ * mutex - a sleeping lock with an owner. Only the owner unlocks it, it is
+ * not recursive, and the owner inherits the priority of its waiters.
+ * */
+typedef struct mutex {
+    volatile long owner;            // the owner proc | MUTEX_WAITERS, 0 if unlocked
+    list_entry_t owner_link;        // entry in owner->pi_mutexes
+    wait_queue_t wait_queue;
+    lockstat_t stat;
+} mutex_t;
+
+#define MUTEX_WAITERS               0x1     // in owner: somebody waits, unlock must hand it over
+
+#define le2mutex(le, member)        \
+    to_struct((le), mutex_t, member)
+
+void mutex_init(mutex_t *mutex);
+void mutex_lock(mutex_t *mutex);
+bool mutex_trylock(mutex_t *mutex);
+void mutex_unlock(mutex_t *mutex);
+void mutex_pi_update(struct proc_struct *proc);
+void check_mutex(void);
+
+static inline struct proc_struct *
+mutex_owner(mutex_t *mutex) {
+    return (struct proc_struct *)(mutex->owner & ~MUTEX_WAITERS);
+}
+
+static inline bool
+mutex_locked(mutex_t *mutex) {
+    return mutex->owner != 0;
+}
+
+#endif /* !__KERN_SYNC_MUTEX_H__ */
+
@@ -0,0 +1,70 @@
+#ifndef __KERN_SYNC_PREEMPT_H__
+#define __KERN_SYNC_PREEMPT_H__
+
+#include <defs.h>
+#include <assert.h>
+#include <sched.h>
+#include <proc.h>
+
+/* *
+ * Kernel preemption
+ *
+ * Kernel code was written for a kernel that only switches where it calls
+ * schedule, so it stays non-preemptible by default: a process runs kernel
+ * code with preempt_count PREEMPT_KERNEL. Code that may be switched out at
+ * any instruction, such as copying a buffer nobody else sees, is put
+ * between preempt_enable and preempt_disable. An interrupt that returns
+ * into it with need_resched set switches to the next process right there
+ * (see trap), and preempt_enable switches if need_resched was set while
+ * preemption was off. preempt_disable/preempt_enable pairs nest.
+ *
+ * Long loops that are not preemptible throughout call cond_resched where
+ * they hold nothing but sleeping locks, the same places they could sleep.
+ * Preempted kernel code may come back on another cpu.
+ *
+ * Without KERNEL_PREEMPT (make PREEMPT=0) the kernel only switches on the
+ * way back to user mode, as it used to.
+ * */
+
+#define PREEMPT_KERNEL              1
+
+static inline void
+preempt_disable(void) {
+    current->preempt_count ++;
+}
+
+static inline void
+preempt_enable(void) {
+    assert(current->preempt_count > 0);
+#ifdef KERNEL_PREEMPT
+    if (-- current->preempt_count == 0 && current->need_resched) {
+        schedule();
+    }
+#else
+    current->preempt_count --;
+#endif
+}
+
+// preemptible - an interrupt returning to the kernel may switch here
+static inline bool
+preemptible(void) {
+#ifdef KERNEL_PREEMPT
+    return current->preempt_count == 0;
+#else
+    return 0;
+#endif
+}
+
+// cond_resched - a preemption point in a long loop of kernel code
+static inline void
+cond_resched(void) {
+#ifdef KERNEL_PREEMPT
+    // nothing runs processes yet when the boot checks get here
+    if (current != NULL && current->need_resched && current->preempt_count <= PREEMPT_KERNEL) {
+        schedule();
+    }
+#endif
+}
+
+#endif /* !__KERN_SYNC_PREEMPT_H__ */
+
@@ -0,0 +1,217 @@
+#include <defs.h>
+#include <wait.h>
+#include <sync.h>
+#include <proc.h>
+#include <sched.h>
+#include <stdio.h>
+#include <assert.h>
+#include <rwsem.h>
+
+/* *
+ * Reader-writer semaphores
+ *
+ * Readers and writers wait on one queue in arrival order. A new reader
+ * gets in at once only while no writer holds the rwsem and nobody waits,
+ * so a stream of readers cannot starve a writer. When the rwsem becomes
+ * free it is handed to the head of the queue: a writer alone, or the
+ * readers at the head up to the next writer together.
+ * */
+
+void
+rwsem_init(rwsem_t *rwsem) {
+    rwsem->count = 0;
+    wait_queue_init(&(rwsem->wait_queue));
+    lockstat_init(&(rwsem->stat));
+}
+
+// rwsem_wait - sleep until the rwsem is handed to current, with interrupts disabled by @intr_flag
+static void
+rwsem_wait(rwsem_t *rwsem, uint32_t wait_state, bool intr_flag) {
+    wait_t __wait, *wait = &__wait;
+    wait_current_set(&(rwsem->wait_queue), wait, wait_state);
+    local_intr_restore(intr_flag);
+
+    schedule();
+
+    local_intr_save(intr_flag);
+    wait_current_del(&(rwsem->wait_queue), wait);
+    local_intr_restore(intr_flag);
+    assert(wait->wakeup_flags == wait_state);
+}
+
+// rwsem_wake - the rwsem became free, hand it to the head of the queue
+static void
+rwsem_wake(rwsem_t *rwsem) {
+    wait_queue_t *queue = &(rwsem->wait_queue);
+    wait_t *wait;
+    assert(rwsem->count == 0);
+    if ((wait = wait_queue_first(queue)) == NULL) {
+        return;
+    }
+    if (wait->proc->wait_state == WT_KRWSEM_WRITE) {
+        rwsem->count = -1;
+        wakeup_wait(queue, wait, WT_KRWSEM_WRITE, 1);
+        return;
+    }
+    while (wait != NULL && wait->proc->wait_state == WT_KRWSEM_READ) {
+        rwsem->count ++;
+        wakeup_wait(queue, wait, WT_KRWSEM_READ, 1);
+        wait = wait_queue_first(queue);
+    }
+}
+
+void
+down_read(rwsem_t *rwsem) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    if (rwsem->count >= 0 && wait_queue_empty(&(rwsem->wait_queue))) {
+        rwsem->count ++;
+        local_intr_restore(intr_flag);
+        lockstat_acquired_shared(&(rwsem->stat), 0);
+        return;
+    }
+    uint64_t wait_start = lockstat_wait_start(&(rwsem->stat));
+    rwsem_wait(rwsem, WT_KRWSEM_READ, intr_flag);
+    lockstat_acquired_shared(&(rwsem->stat), wait_start);
+}
+
+void
+up_read(rwsem_t *rwsem) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        assert(rwsem->count > 0);
+        if (-- rwsem->count == 0) {
+            rwsem_wake(rwsem);
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+void
+down_write(rwsem_t *rwsem) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    if (rwsem->count == 0 && wait_queue_empty(&(rwsem->wait_queue))) {
+        rwsem->count = -1;
+        local_intr_restore(intr_flag);
+        lockstat_acquired(&(rwsem->stat), 0);
+        return;
+    }
+    uint64_t wait_start = lockstat_wait_start(&(rwsem->stat));
+    rwsem_wait(rwsem, WT_KRWSEM_WRITE, intr_flag);
+    lockstat_acquired(&(rwsem->stat), wait_start);
+}
+
+void
+up_write(rwsem_t *rwsem) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        assert(rwsem->count == -1);
+        lockstat_released(&(rwsem->stat));
+        rwsem->count = 0;
+        rwsem_wake(rwsem);
+    }
+    local_intr_restore(intr_flag);
+}
+
+bool
+down_read_trylock(rwsem_t *rwsem) {
+    bool intr_flag, ret = 0;
+    local_intr_save(intr_flag);
+    if (rwsem->count >= 0 && wait_queue_empty(&(rwsem->wait_queue))) {
+        rwsem->count ++, ret = 1;
+    }
+    local_intr_restore(intr_flag);
+    if (ret) {
+        lockstat_acquired_shared(&(rwsem->stat), 0);
+    }
+    return ret;
+}
+
+bool
+down_write_trylock(rwsem_t *rwsem) {
+    bool intr_flag, ret = 0;
+    local_intr_save(intr_flag);
+    if (rwsem->count == 0 && wait_queue_empty(&(rwsem->wait_queue))) {
+        rwsem->count = -1, ret = 1;
+    }
+    local_intr_restore(intr_flag);
+    if (ret) {
+        lockstat_acquired(&(rwsem->stat), 0);
+    }
+    return ret;
+}
+
+/* *
+ * check_rwsem - current reads; a writer comes and waits, then a reader
+ * comes and must wait behind the writer. When current is done the writer
+ * goes first, then the reader. It runs as init before any user process.
+ * */
+
+static rwsem_t check_rw;
+static char check_log[4];
+static int check_nlog;
+
+static void
+check_rwsem_log(char c) {
+    assert(check_nlog < sizeof(check_log) - 1);
+    check_log[check_nlog ++] = c;
+}
+
+static int
+check_rwsem_reader(void *arg) {
+    down_read(&check_rw);
+    check_rwsem_log('R');
+    up_read(&check_rw);
+    return 0;
+}
+
+static int
+check_rwsem_writer(void *arg) {
+    down_write(&check_rw);
+    check_rwsem_log('W');
+    assert(check_rw.count == -1);
+    up_write(&check_rw);
+    return 0;
+}
+
+// check_rwsem_start - start a kernel thread running @fn, and wait until it sleeps in @wait_state
+static int
+check_rwsem_start(int (*fn)(void *), uint32_t wait_state) {
+    int pid;
+    struct proc_struct *proc;
+    assert((pid = kernel_thread(fn, NULL, 0)) > 0 && (proc = find_proc(pid)) != NULL);
+    while (proc->state != PROC_SLEEPING || proc->wait_state != wait_state) {
+        do_sleep(1);
+    }
+    return pid;
+}
+
+void
+check_rwsem(void) {
+    int writer, reader;
+    rwsem_init(&check_rw);
+    assert(down_read_trylock(&check_rw) && down_read_trylock(&check_rw));
+    assert(check_rw.count == 2 && !down_write_trylock(&check_rw));
+    up_read(&check_rw);
+    up_read(&check_rw);
+    assert(down_write_trylock(&check_rw) && !down_read_trylock(&check_rw));
+    up_write(&check_rw);
+    assert(check_rw.count == 0);
+
+    check_nlog = 0;
+    down_read(&check_rw);
+    writer = check_rwsem_start(check_rwsem_writer, WT_KRWSEM_WRITE);
+    reader = check_rwsem_start(check_rwsem_reader, WT_KRWSEM_READ);
+    assert(check_rw.count == 1 && check_nlog == 0);
+    up_read(&check_rw);
+
+    assert(do_wait(writer, NULL) == 0 && do_wait(reader, NULL) == 0);
+    assert(check_nlog == 2 && check_log[0] == 'W' && check_log[1] == 'R');
+    assert(check_rw.count == 0 && wait_queue_empty(&(check_rw.wait_queue)));
+
+    cprintf("check_rwsem() succeeded!\n");
+}
+
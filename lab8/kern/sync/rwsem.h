@@ -0,0 +1,29 @@
+#ifndef __KERN_SYNC_RWSEM_H__
+#define __KERN_SYNC_RWSEM_H__
+
+#include <defs.h>
+#include <wait.h>
+#include <lockstat.h>
+
+/* *
+ * rwsem - a reader-writer semaphore: any number of readers, or one
+ * writer. Waiters are queued in arrival order, and a reader does not get
+ * in past a waiting writer.
+ * */
+typedef struct {
+    int count;                      // the readers holding it, -1 for a writer, 0 if free
+    wait_queue_t wait_queue;
+    lockstat_t stat;                // hold times of writers only
+} rwsem_t;
+
+void rwsem_init(rwsem_t *rwsem);
+void down_read(rwsem_t *rwsem);
+void up_read(rwsem_t *rwsem);
+void down_write(rwsem_t *rwsem);
+void up_write(rwsem_t *rwsem);
+bool down_read_trylock(rwsem_t *rwsem);
+bool down_write_trylock(rwsem_t *rwsem);
+void check_rwsem(void);
+
+#endif /* !__KERN_SYNC_RWSEM_H__ */
+
@@ -3,14 +3,29 @@
 #include <atomic.h>
 #include <kmalloc.h>
 #include <sem.h>
+#include <mutex.h>
+#include <rwsem.h>
 #include <proc.h>
 #include <sync.h>
+#include <clock.h>
+#include <stdio.h>
 #include <assert.h>
 
+/* *
+ * The value of a semaphore is changed with one atomic add, so down and up
+ * do not disable interrupts or look at the wait queue unless they must
+ * wait or wake: down takes a unit if the value was positive, otherwise
+ * the value counts it as a waiter; up wakes a waiter if the value was
+ * negative. The slow paths run with interrupts disabled under the kernel
+ * lock. An up that finds its waiter not queued yet leaves it a wakeup.
+ * */
+
 void
 sem_init(semaphore_t *sem, int value) {
     sem->value = value;
+    sem->wakeups = 0;
     wait_queue_init(&(sem->wait_queue));
+    lockstat_init(&(sem->stat));
 }
 
 static __noinline void __up(semaphore_t *sem, uint32_t wait_state) {
@@ -19,7 +34,7 @@ static __noinline void __up(semaphore_t *sem, uint32_t wait_state) {
     {
         wait_t *wait;
         if ((wait = wait_queue_first(&(sem->wait_queue))) == NULL) {
-            sem->value ++;
+            sem->wakeups ++;
         }
         else {
             assert(wait->proc->wait_state == wait_state);
@@ -29,11 +44,12 @@ static __noinline void __up(semaphore_t *sem, uint32_t wait_state) {
     local_intr_restore(intr_flag);
 }
 
+// __down - current was counted as a waiter, sleep until an up; the waits are not interruptible
 static __noinline uint32_t __down(semaphore_t *sem, uint32_t wait_state) {
     bool intr_flag;
     local_intr_save(intr_flag);
-    if (sem->value > 0) {
-        sem->value --;
+    if (sem->wakeups > 0) {
+        sem->wakeups --;
         local_intr_restore(intr_flag);
         return 0;
     }
@@ -55,23 +71,97 @@ static __noinline uint32_t __down(semaphore_t *sem, uint32_t wait_state) {
 
 void
 up(semaphore_t *sem) {
-    __up(sem, WT_KSEM);
+    lockstat_released(&(sem->stat));
+    if (atomic_fetch_add_release(&(sem->value), 1) < 0) {
+        __up(sem, WT_KSEM);
+    }
 }
 
 void
 down(semaphore_t *sem) {
+    if (atomic_fetch_add_acquire(&(sem->value), -1) > 0) {
+        lockstat_acquired(&(sem->stat), 0);
+        return;
+    }
+    uint64_t wait_start = lockstat_wait_start(&(sem->stat));
     uint32_t flags = __down(sem, WT_KSEM);
     assert(flags == 0);
+    lockstat_acquired(&(sem->stat), wait_start);
 }
 
 bool
 try_down(semaphore_t *sem) {
-    bool intr_flag, ret = 0;
-    local_intr_save(intr_flag);
-    if (sem->value > 0) {
-        sem->value --, ret = 1;
+    int value;
+    while ((value = sem->value) > 0) {
+        if (atomic_cmpxchg_acquire(&(sem->value), value, value - 1) == value) {
+            lockstat_acquired(&(sem->stat), 0);
+            return 1;
+        }
     }
-    local_intr_restore(intr_flag);
-    return ret;
+    return 0;
 }
 
+/* *
+ * sync_bench - cost of an uncontended lock and unlock, run from the kernel
+ * monitor: a semaphore down/up, a mutex lock/unlock, an rwsem read and
+ * write, and for reference the local_intr_save/restore pair that the
+ * slow paths pay, each @nr_rounds times, in timer cycles per pair.
+ * */
+void
+sync_bench(int nr_rounds) {
+    static semaphore_t sem;
+    static mutex_t mutex;
+    static rwsem_t rwsem;
+    uint64_t start, cycles[5];
+    bool intr_flag, has_owner = (current != NULL);
+    int i;
+
+    sem_init(&sem, 1);
+    mutex_init(&mutex);
+    rwsem_init(&rwsem);
+
+    start = get_cycles();
+    for (i = 0; i < nr_rounds; i ++) {
+        local_intr_save(intr_flag);
+        local_intr_restore(intr_flag);
+    }
+    cycles[0] = get_cycles() - start;
+
+    start = get_cycles();
+    for (i = 0; i < nr_rounds; i ++) {
+        down(&sem);
+        up(&sem);
+    }
+    cycles[1] = get_cycles() - start;
+
+    // a mutex needs an owner, without one the row is left out
+    start = get_cycles();
+    for (i = 0; has_owner && i < nr_rounds; i ++) {
+        mutex_lock(&mutex);
+        mutex_unlock(&mutex);
+    }
+    cycles[2] = get_cycles() - start;
+
+    start = get_cycles();
+    for (i = 0; i < nr_rounds; i ++) {
+        down_read(&rwsem);
+        up_read(&rwsem);
+    }
+    cycles[3] = get_cycles() - start;
+
+    start = get_cycles();
+    for (i = 0; i < nr_rounds; i ++) {
+        down_write(&rwsem);
+        up_write(&rwsem);
+    }
+    cycles[4] = get_cycles() - start;
+
+    const char *names[] = {"intr save/restore", "sem down/up", "mutex lock/unlock", "rwsem read", "rwsem write"};
+    for (i = 0; i < sizeof(cycles) / sizeof(cycles[0]); i ++) {
+        if (i == 2 && !has_owner) {
+            cprintf("%-20s %8s\n", names[i], "n/a");
+            continue;
+        }
+        cprintf("%-20s %8d cycles\n", names[i], (int)(cycles[i] / nr_rounds));
+    }
+}
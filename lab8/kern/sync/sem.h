@@ -4,16 +4,20 @@
 #include <defs.h>
 #include <atomic.h>
 #include <wait.h>
+#include <lockstat.h>
 
 typedef struct {
-    int value;
+    volatile int value;             // the units left, or minus the number of processes waiting
+    int wakeups;                    // ups for waiters that were not queued yet
     wait_queue_t wait_queue;
+    lockstat_t stat;
 } semaphore_t;
 
 void sem_init(semaphore_t *sem, int value);
 void up(semaphore_t *sem);
 void down(semaphore_t *sem);
 bool try_down(semaphore_t *sem);
+void sync_bench(int nr_rounds);
 
 #endif /* !__KERN_SYNC_SEM_H__ */
 
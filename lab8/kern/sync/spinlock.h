@@ -0,0 +1,54 @@
+#ifndef __KERN_SYNC_SPINLOCK_H__
+#define __KERN_SYNC_SPINLOCK_H__
+
+#include <defs.h>
+
+/* *
+ * spinlock - a test-and-test-and-set lock for data shared between cpus.
+ * It does not disable interrupts: take it with local_intr_save if an
+ * interrupt handler on the same cpu may want it too.
+ * */
+typedef struct {
+    volatile uint32_t locked;
+} spinlock_t;
+
+static inline void
+spinlock_init(spinlock_t *lock) {
+    lock->locked = 0;
+}
+
+// spin_trylock - take @lock if it is free, return true on success
+static inline bool
+spin_trylock(spinlock_t *lock) {
+    uint32_t old;
+    __asm__ __volatile__("amoswap.w.aq %0, %2, %1"
+                         : "=r"(old), "+A"(lock->locked)
+                         : "r"(1)
+                         : "memory");
+    return old == 0;
+}
+
+static inline void
+spin_lock(spinlock_t *lock) {
+    while (!spin_trylock(lock)) {
+        // wait with plain loads, the amoswap would steal the cache line every time
+        while (lock->locked)
+            /* nothing */ ;
+    }
+}
+
+static inline void
+spin_unlock(spinlock_t *lock) {
+    __asm__ __volatile__("amoswap.w.rl zero, zero, %0"
+                         : "+A"(lock->locked)
+                         :
+                         : "memory");
+}
+
+static inline bool
+spin_locked(spinlock_t *lock) {
+    return lock->locked != 0;
+}
+
+#endif /* !__KERN_SYNC_SPINLOCK_H__ */
+
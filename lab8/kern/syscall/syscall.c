@@ -7,8 +7,19 @@
 #include <assert.h>
 #include <clock.h>
 #include <sysfile.h>
+#include <time.h>
+#include <vmm.h>
+#include <error.h>
+#include <futex.h>
+#include <resource.h>
 static int
 sys_exit(uint64_t arg[]) {
+    int error_code = (int)arg[0];
+    return do_exit_group(error_code);
+}
+
+static int
+sys_exit_thread(uint64_t arg[]) {
     int error_code = (int)arg[0];
     return do_exit(error_code);
 }
@@ -20,6 +31,14 @@ sys_fork(uint64_t arg[]) {
     return do_fork(0, stack, tf);
 }
 
+static int
+sys_clone(uint64_t arg[]) {
+    uint32_t clone_flags = (uint32_t)arg[0];
+    uintptr_t stack = (uintptr_t)arg[1];
+    uintptr_t tls = (uintptr_t)arg[2];
+    return do_clone(clone_flags, stack, tls);
+}
+
 static int
 sys_wait(uint64_t arg[]) {
     int pid = (int)arg[0];
@@ -63,7 +82,7 @@ sys_pgdir(uint64_t arg[]) {
     return 0;
 }
 static int sys_gettime(uint64_t arg[]){
-    return (int)ticks*10;
+    return (int)(clock_ns() / NSEC_PER_MSEC);
 }
 static int sys_lab6_set_priority(uint64_t arg[]){
     uint64_t priority = (uint64_t)arg[0];
@@ -71,6 +90,93 @@ static int sys_lab6_set_priority(uint64_t arg[]){
     return 0;
 }
 static int
+sys_sched_setscheduler(uint64_t arg[]) {
+    int pid = (int)arg[0];
+    int policy = (int)arg[1];
+    int priority = (int)arg[2];
+    return do_sched_setscheduler(pid, policy, priority);
+}
+static int
+sys_nanosleep(uint64_t arg[]) {
+    struct mm_struct *mm = current->mm;
+    const struct timespec *__req = (const struct timespec *)arg[0];
+    struct timespec *__rem = (struct timespec *)arg[1];
+    struct timespec req, rem;
+    uint64_t remain;
+    int ret;
+
+    lock_mm_read(mm);
+    {
+        if (!copy_from_user(mm, &req, __req, sizeof(struct timespec), 0)) {
+            unlock_mm_read(mm);
+            return -E_INVAL;
+        }
+    }
+    unlock_mm_read(mm);
+    if (req.tv_sec < 0 || req.tv_nsec < 0 || req.tv_nsec >= NSEC_PER_SEC) {
+        return -E_INVAL;
+    }
+
+    ret = do_nanosleep(timespec_to_ns(&req), &remain);
+    if (ret != 0 && __rem != NULL) {
+        ns_to_timespec(remain, &rem);
+        lock_mm_read(mm);
+        {
+            copy_to_user(mm, __rem, &rem, sizeof(struct timespec));
+        }
+        unlock_mm_read(mm);
+    }
+    return ret;
+}
+static int
+sys_getrusage(uint64_t arg[]) {
+    struct mm_struct *mm = current->mm;
+    int who = (int)arg[0];
+    struct rusage *__usage = (struct rusage *)arg[1];
+    struct rusage usage;
+    int ret;
+    if ((ret = do_getrusage(who, &usage)) != 0) {
+        return ret;
+    }
+    lock_mm_read(mm);
+    {
+        if (!copy_to_user(mm, __usage, &usage, sizeof(struct rusage))) {
+            ret = -E_INVAL;
+        }
+    }
+    unlock_mm_read(mm);
+    return ret;
+}
+
+static int
+sys_futex(uint64_t arg[]) {
+    uintptr_t uaddr = (uintptr_t)arg[0];
+    int op = (int)arg[1];
+    int val = (int)arg[2];
+    return do_futex(uaddr, op, val);
+}
+
+static int
+sys_clock_gettime(uint64_t arg[]) {
+    struct mm_struct *mm = current->mm;
+    int clock_id = (int)arg[0];
+    struct timespec *__tp = (struct timespec *)arg[1];
+    struct timespec tp;
+    int ret = 0;
+    if (clock_id != CLOCK_MONOTONIC) {
+        return -E_INVAL;
+    }
+    ns_to_timespec(clock_ns(), &tp);
+    lock_mm_read(mm);
+    {
+        if (!copy_to_user(mm, __tp, &tp, sizeof(struct timespec))) {
+            ret = -E_INVAL;
+        }
+    }
+    unlock_mm_read(mm);
+    return ret;
+}
+static int
 sys_sleep(uint64_t arg[]) {
     unsigned int time = (unsigned int)arg[0];
     return do_sleep(time);
@@ -150,6 +256,8 @@ static int (*syscalls[])(uint64_t arg[]) = {
     [SYS_fork]              sys_fork,
     [SYS_wait]              sys_wait,
     [SYS_exec]              sys_exec,
+    [SYS_clone]             sys_clone,
+    [SYS_exit_thread]       sys_exit_thread,
     [SYS_yield]             sys_yield,
     [SYS_kill]              sys_kill,
     [SYS_getpid]            sys_getpid,
@@ -157,7 +265,12 @@ static int (*syscalls[])(uint64_t arg[]) = {
     [SYS_pgdir]             sys_pgdir,
     [SYS_gettime]           sys_gettime,
     [SYS_lab6_set_priority] sys_lab6_set_priority,
+    [SYS_sched_setscheduler]    sys_sched_setscheduler,
     [SYS_sleep]             sys_sleep,
+    [SYS_nanosleep]         sys_nanosleep,
+    [SYS_clock_gettime]     sys_clock_gettime,
+    [SYS_futex]             sys_futex,
+    [SYS_getrusage]         sys_getrusage,
     [SYS_open]              sys_open,
     [SYS_close]             sys_close,
     [SYS_read]              sys_read,
@@ -17,6 +17,9 @@
 #include <sync.h>
 #include <sbi.h>
 #include <proc.h>
+#include <dev.h>
+#include <preempt.h>
+#include <hrtimer.h>
 
 #define TICK_NUM 2
 
@@ -41,6 +44,18 @@ idt_init(void) {
     set_csr(sstatus, SSTATUS_SUM);
 }
 
+/* *
+ * kstack_overflow - entered by __alltraps, on the emergency stack of the
+ * cpu, for a trap in the kernel whose trapframe did not fit in the kstack
+ * of the running process any more. @sp, @epc and @tval are those of the
+ * trap.
+ * */
+void __noreturn
+kstack_overflow(uintptr_t sp, uintptr_t epc, uintptr_t tval) {
+    panic("kernel stack overflow: pid %d, sp 0x%08lx, epc 0x%08lx, tval 0x%08lx.\n",
+          (current != NULL) ? current->pid : -1, sp, epc, tval);
+}
+
 /* trap_in_kernel - test if trap happened in kernel */
 bool trap_in_kernel(struct trapframe *tf) {
     return (tf->status & SSTATUS_SPP) != 0;
@@ -124,12 +139,14 @@ extern struct mm_struct *check_mm_struct;
 
 void interrupt_handler(struct trapframe *tf) {
     intptr_t cause = (tf->cause << 1) >> 1;
+    int n;
     switch (cause) {
         case IRQ_U_SOFT:
             cprintf("User software interrupt\n");
             break;
         case IRQ_S_SOFT:
-            cprintf("Supervisor software interrupt\n");
+            // an IPI from another cpu
+            smp_ipi_handler();
             break;
         case IRQ_H_SOFT:
             cprintf("Hypervisor software interrupt\n");
@@ -146,10 +163,19 @@ void interrupt_handler(struct trapframe *tf) {
             // In fact, Call sbi_set_timer will clear STIP, or you can clear it
             // directly.
             // clear_csr(sip, SIP_STIP);
-            clock_set_next_event();
-            ++ticks;
-            run_timer_list();
-            dev_stdin_write(cons_getc());
+            // catch up the ticks skipped while the cpu was idle
+            n = clock_elapsed_ticks();
+            while (n -- > 0) {
+                if (cpu_is_boot()) {
+                    ++ticks;
+                }
+                run_timer_list();
+            }
+            // the boot cpu keeps the time for everyone
+            if (cpu_is_boot()) {
+                hrtimer_run();
+                dev_stdin_write(cons_getc());
+            }
             break;
         case IRQ_H_TIMER:
             cprintf("Hypervisor software interrupt\n");
@@ -185,6 +211,10 @@ void exception_handler(struct trapframe *tf) {
             cprintf("Instruction access fault\n");
             break;
         case CAUSE_ILLEGAL_INSTRUCTION:
+            // the first FP instruction since the process lost the FP registers
+            if (!trap_in_kernel(tf) && current != NULL && fpu_trap(tf)) {
+                break;
+            }
             cprintf("Illegal instruction\n");
             break;
         case CAUSE_BREAKPOINT:
@@ -192,6 +222,9 @@ void exception_handler(struct trapframe *tf) {
             if(tf->gpr.a7 == 10){
                 tf->epc += 4;
                 syscall();
+                // the kernel thread becomes a user process and leaves the kernel
+                sched_acct_system();
+                unlock_kernel();
                 kernel_execve_ret(tf,current->kstack+KSTACKSIZE);
             }
             break;
@@ -275,11 +308,16 @@ trap(struct trapframe *tf) {
     if (current == NULL) {
         trap_dispatch(tf);
     } else {
+        bool in_kernel = trap_in_kernel(tf);
+        // user code runs without the kernel lock, kernel code with it
+        if (!in_kernel) {
+            lock_kernel();
+            sched_acct_user();
+        }
+
         struct trapframe *otf = current->tf;
         current->tf = tf;
 
-        bool in_kernel = trap_in_kernel(tf);
-
         trap_dispatch(tf);
 
         current->tf = otf;
@@ -290,6 +328,13 @@ trap(struct trapframe *tf) {
             if (current->need_resched) {
                 schedule();
             }
+            fpu_return_user(tf);
+            sched_acct_system();
+            unlock_kernel();
+        }
+        else if ((intptr_t)tf->cause < 0 && current->need_resched && preemptible()) {
+            // an interrupt in a preemptible section of the kernel
+            schedule();
         }
     }
 }
@@ -51,6 +51,7 @@ void idt_init(void);
 void print_trapframe(struct trapframe *tf);
 void print_regs(struct pushregs* gpr);
 bool trap_in_kernel(struct trapframe *tf);
+void __noreturn kstack_overflow(uintptr_t sp, uintptr_t epc, uintptr_t tval);
 
 #endif /* !__KERN_TRAP_TRAP_H__ */
 
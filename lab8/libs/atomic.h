@@ -106,4 +106,112 @@ static inline bool test_and_clear_bit(int nr, volatile void *addr) {
     return __test_and_op_bit(and, __NOT, nr, ((volatile unsigned long *)addr));
 }
 
+/* *
+ * Atomic operations on words
+ *
+ * atomic_<op> works on an int, atomic_long_<op> on a long:
+ *   atomic_fetch_add/and/or/xor(addr, val) - amo<op>, return the old value
+ *   atomic_xchg(addr, new)                - amoswap, return the old value
+ *   atomic_cmpxchg(addr, old, new)        - lr/sc, store @new if *addr is
+ *                                           @old, return what *addr held
+ *
+ * Without a suffix an operation is fully ordered. The _relaxed variants
+ * order nothing, _acquire keeps the accesses after it behind it (taking
+ * a lock) and _release keeps the accesses before it ahead of it
+ * (dropping a lock).
+ * */
+
+#define __ORDER                 ".aqrl"
+#define __ORDER_relaxed         ""
+#define __ORDER_acquire         ".aq"
+#define __ORDER_release         ".rl"
+
+// lr/sc: fully ordered is lr.aqrl/sc.rl (the RVWMO mapping), lr.aq/sc.rl alone lets
+// a store before the pair pass a load after it
+#define __LR_ORDER              ".aqrl"
+#define __SC_ORDER              ".rl"
+#define __LR_ORDER_relaxed      ""
+#define __SC_ORDER_relaxed      ""
+#define __LR_ORDER_acquire      ".aq"
+#define __SC_ORDER_acquire      ""
+#define __LR_ORDER_release      ""
+#define __SC_ORDER_release      ".rl"
+
+#define __ATOMIC_FETCH_OP(prefix, type, width, name, asm_op, order)                     \
+    static inline __attribute__((always_inline)) type                                   \
+    prefix##_fetch_##name##order(volatile type *addr, type val) {                       \
+        type prev;                                                                      \
+        __asm__ __volatile__("amo" #asm_op "." #width __ORDER##order " %0, %2, %1"      \
+                             : "=r"(prev), "+A"(*addr)                                  \
+                             : "r"(val)                                                 \
+                             : "memory");                                               \
+        return prev;                                                                    \
+    }
+
+#define __ATOMIC_XCHG(prefix, type, width, order)                                       \
+    static inline __attribute__((always_inline)) type                                   \
+    prefix##_xchg##order(volatile type *addr, type new) {                               \
+        type prev;                                                                      \
+        __asm__ __volatile__("amoswap." #width __ORDER##order " %0, %2, %1"             \
+                             : "=r"(prev), "+A"(*addr)                                  \
+                             : "r"(new)                                                 \
+                             : "memory");                                               \
+        return prev;                                                                    \
+    }
+
+#define __ATOMIC_CMPXCHG(prefix, type, width, order)                                    \
+    static inline __attribute__((always_inline)) type                                   \
+    prefix##_cmpxchg##order(volatile type *addr, type old, type new) {                  \
+        type prev;                                                                      \
+        int fail;                                                                       \
+        __asm__ __volatile__("1: lr." #width __LR_ORDER##order " %0, %2\n"              \
+                             "   bne %0, %3, 2f\n"                                      \
+                             "   sc." #width __SC_ORDER##order " %1, %4, %2\n"          \
+                             "   bnez %1, 1b\n"                                         \
+                             "2:\n"                                                     \
+                             : "=&r"(prev), "=&r"(fail), "+A"(*addr)                    \
+                             : "r"(old), "r"(new)                                       \
+                             : "memory");                                               \
+        return prev;                                                                    \
+    }
+
+#define __ATOMIC_OPS(prefix, type, width, order)                                        \
+    __ATOMIC_FETCH_OP(prefix, type, width, add, add, order)                             \
+    __ATOMIC_FETCH_OP(prefix, type, width, and, and, order)                             \
+    __ATOMIC_FETCH_OP(prefix, type, width, or, or, order)                               \
+    __ATOMIC_FETCH_OP(prefix, type, width, xor, xor, order)                             \
+    __ATOMIC_XCHG(prefix, type, width, order)                                           \
+    __ATOMIC_CMPXCHG(prefix, type, width, order)
+
+#define __ATOMIC_ALL_ORDERS(prefix, type, width)                                        \
+    __ATOMIC_OPS(prefix, type, width, )                                                 \
+    __ATOMIC_OPS(prefix, type, width, _relaxed)                                         \
+    __ATOMIC_OPS(prefix, type, width, _acquire)                                         \
+    __ATOMIC_OPS(prefix, type, width, _release)
+
+__ATOMIC_ALL_ORDERS(atomic, int, w)
+__ATOMIC_ALL_ORDERS(atomic_long, long, d)
+
+/* *
+ * Barriers, and plain loads and stores with ordering: an acquire load
+ * keeps the accesses after it behind it, a release store keeps the
+ * accesses before it ahead of it.
+ * */
+#define smp_mb()                __asm__ __volatile__("fence rw, rw" : : : "memory")
+#define smp_rmb()               __asm__ __volatile__("fence r, r" : : : "memory")
+#define smp_wmb()               __asm__ __volatile__("fence w, w" : : : "memory")
+
+static inline __attribute__((always_inline)) int
+atomic_load_acquire(volatile int *addr) {
+    int val = *addr;
+    __asm__ __volatile__("fence r, rw" : : : "memory");
+    return val;
+}
+
+static inline __attribute__((always_inline)) void
+atomic_store_release(volatile int *addr, int val) {
+    __asm__ __volatile__("fence rw, w" : : : "memory");
+    *addr = val;
+}
+
 #endif /* !__LIBS_ATOMIC_H__ */
@@ -0,0 +1,21 @@
+#ifndef __LIBS_RESOURCE_H__
+#define __LIBS_RESOURCE_H__
+
+#include <defs.h>
+#include <time.h>
+
+/* who for SYS_getrusage */
+#define RUSAGE_SELF         0           // the calling process
+#define RUSAGE_CHILDREN     (-1)        // its children that were waited for, and theirs
+
+struct rusage {
+    struct timespec ru_utime;           // time spent in user mode
+    struct timespec ru_stime;           // time spent in the kernel
+    struct timespec ru_rqdelay;         // time spent runnable, waiting for a cpu
+    struct timespec ru_rqdelay_max;     // the longest of those waits
+    uint64_t ru_nvcsw;                  // context switches because it slept
+    uint64_t ru_nivcsw;                 // context switches while it could still run
+};
+
+#endif /* !__LIBS_RESOURCE_H__ */
+
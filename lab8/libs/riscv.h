@@ -242,6 +242,8 @@
 
 #define barrier() __asm__ __volatile__ ("fence" ::: "memory")
 
+#define wfi() __asm__ __volatile__ ("wfi")
+
 static inline void
 lcr3(unsigned long cr3) {
     write_csr(satp, 0x8000000000000000 | (cr3 >> RISCV_PGSHIFT));
@@ -26,6 +26,10 @@
 #define SBI_REMOTE_SFENCE_VMA_ASID 7
 #define SBI_SHUTDOWN 8
 
+/* SBI v0.2 extensions, called with the extension id in a7 and the function id in a6 */
+#define SBI_EXT_HSM 0x48534D
+#define SBI_EXT_HSM_HART_START 0
+
 #define SBI_CALL(which, arg0, arg1, arg2) ({			\
 	register uintptr_t a0 asm ("a0") = (uintptr_t)(arg0);	\
 	register uintptr_t a1 asm ("a1") = (uintptr_t)(arg1);	\
@@ -38,6 +42,19 @@
 	a0;							\
 })
 
+#define SBI_ECALL(ext, fid, arg0, arg1, arg2) ({		\
+	register uintptr_t a0 asm ("a0") = (uintptr_t)(arg0);	\
+	register uintptr_t a1 asm ("a1") = (uintptr_t)(arg1);	\
+	register uintptr_t a2 asm ("a2") = (uintptr_t)(arg2);	\
+	register uintptr_t a6 asm ("a6") = (uintptr_t)(fid);	\
+	register uintptr_t a7 asm ("a7") = (uintptr_t)(ext);	\
+	asm volatile ("ecall"					\
+		      : "+r" (a0), "+r" (a1)			\
+		      : "r" (a2), "r" (a6), "r" (a7)		\
+		      : "memory");				\
+	(long)a0;						\
+})
+
 /* Lazy implementations until SBI is finalized */
 #define SBI_CALL_0(which) SBI_CALL(which, 0, 0, 0)
 #define SBI_CALL_1(which, arg0) SBI_CALL(which, arg0, 0, 0)
@@ -86,7 +103,7 @@ static inline void sbi_remote_sfence_vma(const unsigned long *hart_mask,
 					 unsigned long start,
 					 unsigned long size)
 {
-	SBI_CALL_1(SBI_REMOTE_SFENCE_VMA, hart_mask);
+	SBI_CALL(SBI_REMOTE_SFENCE_VMA, hart_mask, start, size);
 }
 
 static inline void sbi_remote_sfence_vma_asid(const unsigned long *hart_mask,
@@ -97,4 +114,16 @@ static inline void sbi_remote_sfence_vma_asid(const unsigned long *hart_mask,
 	SBI_CALL_1(SBI_REMOTE_SFENCE_VMA_ASID, hart_mask);
 }
 
+/*
+ * Start @hartid at the physical address @start_addr in S-mode with the MMU
+ * off, a0 = @hartid and a1 = @opaque. Returns 0 or a negative SBI error,
+ * e.g. for a hart that does not exist or an SBI without HSM.
+ */
+static inline long sbi_hart_start(unsigned long hartid,
+				  unsigned long start_addr,
+				  unsigned long opaque)
+{
+	return SBI_ECALL(SBI_EXT_HSM, SBI_EXT_HSM_HART_START, hartid, start_addr, opaque);
+}
+
 #endif /* !__SBI_H__ */
@@ -0,0 +1,30 @@
+#ifndef __LIBS_TIME_H__
+#define __LIBS_TIME_H__
+
+#include <defs.h>
+
+struct timespec {
+    int64_t tv_sec;                     // seconds
+    int64_t tv_nsec;                    // nanoseconds, 0 .. NSEC_PER_SEC - 1
+};
+
+#define NSEC_PER_SEC        1000000000UL
+#define NSEC_PER_MSEC       1000000UL
+#define NSEC_PER_USEC       1000UL
+
+/* clocks for SYS_clock_gettime */
+#define CLOCK_MONOTONIC     1           // time since boot, never goes back
+
+static inline uint64_t
+timespec_to_ns(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static inline void
+ns_to_timespec(uint64_t ns, struct timespec *ts) {
+    ts->tv_sec = ns / NSEC_PER_SEC;
+    ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
+#endif /* !__LIBS_TIME_H__ */
+
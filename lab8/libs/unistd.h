@@ -9,6 +9,7 @@
 #define SYS_wait            3
 #define SYS_exec            4
 #define SYS_clone           5
+#define SYS_exit_thread     9
 #define SYS_yield           10
 #define SYS_sleep           11
 #define SYS_kill            12
@@ -19,6 +20,11 @@
 #define SYS_shmem           22
 #define SYS_putc            30
 #define SYS_pgdir           31
+#define SYS_sched_setscheduler  40
+#define SYS_nanosleep       41
+#define SYS_clock_gettime   42
+#define SYS_futex           43
+#define SYS_getrusage       44
 #define SYS_open            100
 #define SYS_close           101
 #define SYS_read            102
@@ -32,10 +38,23 @@
 /* OLNY FOR LAB6 */
 #define SYS_lab6_set_priority 255
 
+/* scheduling policies for SYS_sched_setscheduler */
+#define SCHED_NORMAL        0           // the scheduler class chosen at build time
+#define SCHED_FIFO          1           // real-time, run until block or yield
+#define SCHED_RR            2           // real-time, round robin among the same priority
+#define SCHED_RT_PRIO_MAX   32          // real-time priorities are 1 .. SCHED_RT_PRIO_MAX - 1
+
+/* SYS_futex operations */
+#define FUTEX_WAIT          0   // sleep if the word still holds the value
+#define FUTEX_WAKE          1   // wake up at most that many sleepers
+#define FUTEX_WAKE_ALL      0x7fffffff  // FUTEX_WAKE: as many as there are
+
 /* SYS_fork flags */
 #define CLONE_VM            0x00000100  // set if VM shared between processes
 #define CLONE_THREAD        0x00000200  // thread group
 #define CLONE_FS            0x00000800  // set if shared between processes
+#define CLONE_VFORK         0x00004000  // the parent sleeps until the child execs or exits
+#define CLONE_SETTLS        0x00080000  // SYS_clone: set tp of the child to the tls argument
 
 /* VFS flags */
 // flags for open: choose one of these
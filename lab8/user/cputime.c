@@ -0,0 +1,82 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <time.h>
+#include <resource.h>
+
+/* *
+ * cputime - getrusage: a loop without system calls is charged as user
+ * time, a loop of system calls mostly as system time, sleeping counts as
+ * voluntary switches, and the children reaped show up in RUSAGE_CHILDREN.
+ * Several busy children at once have to wait on the run queue.
+ * */
+
+#define NR_CHILDREN     4
+#define SPIN_MSECS      100
+
+static volatile unsigned long sink;
+
+static uint64_t
+ts_msecs(const struct timespec *ts) {
+    return ts->tv_sec * 1000 + ts->tv_nsec / NSEC_PER_MSEC;
+}
+
+static void
+spin(unsigned int msecs) {
+    unsigned int start = gettime_msec();
+    while (gettime_msec() - start < msecs) {
+        int i;
+        for (i = 0; i < 10000; i ++) {
+            sink += i;
+        }
+    }
+}
+
+static void
+print_rusage(const char *who, struct rusage *ru) {
+    cprintf("cputime: %s: user %d ms, sys %d ms, rq delay %d ms (max %d us), csw %d/%d\n", who,
+            (int)ts_msecs(&(ru->ru_utime)), (int)ts_msecs(&(ru->ru_stime)),
+            (int)ts_msecs(&(ru->ru_rqdelay)), (int)(ru->ru_rqdelay_max.tv_nsec / NSEC_PER_USEC),
+            (int)ru->ru_nvcsw, (int)ru->ru_nivcsw);
+}
+
+int
+main(void) {
+    struct rusage before, after;
+    int i, pid;
+
+    assert(getrusage(RUSAGE_SELF, &before) == 0);
+    spin(SPIN_MSECS);
+    assert(getrusage(RUSAGE_SELF, &after) == 0);
+    // most of it in user mode, gettime_msec is a system call too
+    assert(ts_msecs(&(after.ru_utime)) > ts_msecs(&(before.ru_utime)));
+
+    before = after;
+    for (i = 0; i < 1000; i ++) {
+        getpid();
+    }
+    for (i = 0; i < 5; i ++) {
+        sleep(1);
+    }
+    assert(getrusage(RUSAGE_SELF, &after) == 0);
+    assert(after.ru_nvcsw >= before.ru_nvcsw + 5);
+    print_rusage("self", &after);
+
+    for (i = 0; i < NR_CHILDREN; i ++) {
+        if ((pid = fork()) == 0) {
+            spin(SPIN_MSECS);
+            exit(0);
+        }
+        assert(pid > 0);
+    }
+    for (i = 0; i < NR_CHILDREN; i ++) {
+        assert(wait() == 0);
+    }
+    assert(getrusage(RUSAGE_CHILDREN, &after) == 0);
+    assert(ts_msecs(&(after.ru_utime)) + ts_msecs(&(after.ru_stime)) > 0);
+    print_rusage("children", &after);
+    assert(getrusage(2, &after) != 0);
+
+    cprintf("cputime pass.\n");
+    return 0;
+}
+
@@ -0,0 +1,45 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <time.h>
+
+/* *
+ * exitlat - how long a parent waits for a large child to exit. The parent
+ * touches BIGMEM_SIZE bytes, so every fork child owns as many pages, then
+ * ROUNDS times forks a child that sleeps, kills it and records the time
+ * from the kill until waitpid returns. The child's exit and the reaping
+ * are on that path, the freeing of its pages and page tables is left to
+ * the reaper.
+ * */
+
+#define ROUNDS          20
+#define BIGMEM_SIZE     (4 * 1024 * 1024)
+
+static char bigmem[BIGMEM_SIZE];
+static uint64_t lat[ROUNDS];
+
+int
+main(void) {
+    int i, pid, code;
+    for (i = 0; i < BIGMEM_SIZE; i += 4096) {
+        bigmem[i] = i;
+    }
+    for (i = 0; i < ROUNDS; i ++) {
+        if ((pid = fork()) == 0) {
+            while (1) {
+                sleep(100);
+            }
+        }
+        assert(pid > 0);
+        // let the child get to its sleep
+        yield();
+        uint64_t start = now_ns();
+        assert(kill(pid) == 0 && waitpid(pid, &code) == 0);
+        lat[i] = now_ns() - start;
+    }
+
+    sort_u64(lat, ROUNDS);
+    cprintf("exitlat: %d KB child, kill to wait p50 %d us, max %d us\n", BIGMEM_SIZE / 1024,
+            (int)(lat[ROUNDS / 2] / NSEC_PER_USEC), (int)(lat[ROUNDS - 1] / NSEC_PER_USEC));
+    cprintf("exitlat pass.\n");
+    return 0;
+}
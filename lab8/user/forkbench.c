@@ -0,0 +1,52 @@
+#include <ulib.h>
+#include <stdio.h>
+
+/* *
+ * forkbench - fork/exit throughput.
+ * Phase 1 forks and reaps one child at a time, phase 2 builds a forktree
+ * of depth DEPTH where every node waits for its two children.
+ * */
+
+#define ROUNDS          500
+#define DEPTH           7
+
+static int
+forktree(int depth) {
+    int pid0, pid1, code0, code1;
+    if (depth == 0) {
+        return 1;
+    }
+    if ((pid0 = fork()) == 0) {
+        exit(forktree(depth - 1));
+    }
+    if ((pid1 = fork()) == 0) {
+        exit(forktree(depth - 1));
+    }
+    assert(pid0 > 0 && pid1 > 0);
+    assert(waitpid(pid0, &code0) == 0 && waitpid(pid1, &code1) == 0);
+    return code0 + code1 + 1;
+}
+
+int
+main(void) {
+    int i, pid, code;
+    unsigned int time = gettime_msec();
+    for (i = 0; i < ROUNDS; i ++) {
+        if ((pid = fork()) == 0) {
+            exit(0);
+        }
+        assert(pid > 0 && waitpid(pid, &code) == 0 && code == 0);
+    }
+    time = gettime_msec() - time;
+    cprintf("forkbench: %d fork/exit/wait in %d msecs.\n", ROUNDS, time);
+
+    time = gettime_msec();
+    int n = forktree(DEPTH);
+    time = gettime_msec() - time;
+    assert(n == (1 << (DEPTH + 1)) - 1);
+    cprintf("forkbench: forktree of %d procs in %d msecs.\n", n, time);
+
+    cprintf("forkbench pass.\n");
+    return 0;
+}
+
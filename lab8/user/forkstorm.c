@@ -0,0 +1,39 @@
+#include <ulib.h>
+#include <stdio.h>
+
+/* *
+ * forkstorm - fork with many live processes.
+ * Each round forks NR_LIVE children that exit at once; they stay zombies,
+ * holding their pids, until the round reaps them all. ROUNDS * NR_LIVE is
+ * larger than MAX_PID in the kernel, so pid allocation wraps around while
+ * the pid space is crowded.
+ * */
+
+#define NR_LIVE         500
+#define ROUNDS          20
+
+static int pids[NR_LIVE];
+
+int
+main(void) {
+    int i, round, code;
+    unsigned int time, fork_time = 0, total = gettime_msec();
+    for (round = 0; round < ROUNDS; round ++) {
+        time = gettime_msec();
+        for (i = 0; i < NR_LIVE; i ++) {
+            if ((pids[i] = fork()) == 0) {
+                exit(0);
+            }
+            assert(pids[i] > 0);
+        }
+        fork_time += gettime_msec() - time;
+        for (i = 0; i < NR_LIVE; i ++) {
+            assert(waitpid(pids[i], &code) == 0 && code == 0);
+        }
+    }
+    total = gettime_msec() - total;
+    cprintf("forkstorm: %d forks with %d live procs: fork %d msecs, total %d msecs.\n",
+            ROUNDS * NR_LIVE, NR_LIVE, fork_time, total);
+    cprintf("forkstorm pass.\n");
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <ulib.h>
+#include <stdio.h>
+
+/* *
+ * fpbench - FP-heavy work in NR_WORKERS processes at once: each multiplies
+ * double matrices, with a yield every round so they keep taking the cpu
+ * from each other. Only a switch to a process whose FP registers are not
+ * loaded costs a restore, and only a process that wrote them a save.
+ * */
+
+#define NR_WORKERS      4
+#define MATSIZE         16
+#define ROUNDS          200
+
+static double mata[MATSIZE][MATSIZE];
+static double matb[MATSIZE][MATSIZE];
+static double matc[MATSIZE][MATSIZE];
+
+static int
+work(int seed) {
+    int i, j, k, round;
+    for (i = 0; i < MATSIZE; i ++) {
+        for (j = 0; j < MATSIZE; j ++) {
+            mata[i][j] = (seed + i) * 0.5;
+            matb[i][j] = 1.0 / (1 + seed + j);
+        }
+    }
+    for (round = 0; round < ROUNDS; round ++) {
+        for (i = 0; i < MATSIZE; i ++) {
+            for (j = 0; j < MATSIZE; j ++) {
+                double sum = 0.0;
+                for (k = 0; k < MATSIZE; k ++) {
+                    sum += mata[i][k] * matb[k][j];
+                }
+                matc[i][j] = sum;
+            }
+        }
+        for (i = 0; i < MATSIZE; i ++) {
+            for (j = 0; j < MATSIZE; j ++) {
+                mata[i][j] = matc[i][j] / (1.0 + matc[i][j]);
+            }
+        }
+        yield();
+    }
+    // every element is in (0, 1)
+    return (mata[0][0] > 0.0 && mata[0][0] < 1.0) ? 0 : -1;
+}
+
+int
+main(void) {
+    int pids[NR_WORKERS], i, code;
+    unsigned int time = gettime_msec();
+    for (i = 0; i < NR_WORKERS; i ++) {
+        if ((pids[i] = fork()) == 0) {
+            exit(work(i));
+        }
+        assert(pids[i] > 0);
+    }
+    for (i = 0; i < NR_WORKERS; i ++) {
+        assert(waitpid(pids[i], &code) == 0 && code == 0);
+    }
+    time = gettime_msec() - time;
+    cprintf("fpbench: %d workers x %d rounds of %dx%d double matrix: %d msecs.\n",
+            NR_WORKERS, ROUNDS, MATSIZE, MATSIZE, time);
+    cprintf("fpbench pass.\n");
+    return 0;
+}
+
@@ -0,0 +1,158 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/* *
+ * fptest - the FP registers are switched with the process. NR_PROCS
+ * children each load all 32 FP registers and fcsr with a pattern of their
+ * own, yield in the middle of the same asm block, and check nothing
+ * changed when they get the cpu back. A forked child starts with the FP
+ * state of its parent.
+ * */
+
+#define NR_PROCS        4
+#define ROUNDS          200
+
+struct fp_regs {
+    uint64_t f[32];
+    uint64_t fcsr;
+};
+
+// fp_yield - load @in into the FP registers, yield, and store them into @out
+static void
+fp_yield(struct fp_regs *in, struct fp_regs *out) {
+    __asm__ __volatile__(
+        "fld f0, 0*8(%0)\n"
+        "fld f1, 1*8(%0)\n"
+        "fld f2, 2*8(%0)\n"
+        "fld f3, 3*8(%0)\n"
+        "fld f4, 4*8(%0)\n"
+        "fld f5, 5*8(%0)\n"
+        "fld f6, 6*8(%0)\n"
+        "fld f7, 7*8(%0)\n"
+        "fld f8, 8*8(%0)\n"
+        "fld f9, 9*8(%0)\n"
+        "fld f10, 10*8(%0)\n"
+        "fld f11, 11*8(%0)\n"
+        "fld f12, 12*8(%0)\n"
+        "fld f13, 13*8(%0)\n"
+        "fld f14, 14*8(%0)\n"
+        "fld f15, 15*8(%0)\n"
+        "fld f16, 16*8(%0)\n"
+        "fld f17, 17*8(%0)\n"
+        "fld f18, 18*8(%0)\n"
+        "fld f19, 19*8(%0)\n"
+        "fld f20, 20*8(%0)\n"
+        "fld f21, 21*8(%0)\n"
+        "fld f22, 22*8(%0)\n"
+        "fld f23, 23*8(%0)\n"
+        "fld f24, 24*8(%0)\n"
+        "fld f25, 25*8(%0)\n"
+        "fld f26, 26*8(%0)\n"
+        "fld f27, 27*8(%0)\n"
+        "fld f28, 28*8(%0)\n"
+        "fld f29, 29*8(%0)\n"
+        "fld f30, 30*8(%0)\n"
+        "fld f31, 31*8(%0)\n"
+        "ld t0, 32*8(%0)\n"
+        "fscsr t0\n"
+        "li a0, %2\n"
+        "ecall\n"
+        "fsd f0, 0*8(%1)\n"
+        "fsd f1, 1*8(%1)\n"
+        "fsd f2, 2*8(%1)\n"
+        "fsd f3, 3*8(%1)\n"
+        "fsd f4, 4*8(%1)\n"
+        "fsd f5, 5*8(%1)\n"
+        "fsd f6, 6*8(%1)\n"
+        "fsd f7, 7*8(%1)\n"
+        "fsd f8, 8*8(%1)\n"
+        "fsd f9, 9*8(%1)\n"
+        "fsd f10, 10*8(%1)\n"
+        "fsd f11, 11*8(%1)\n"
+        "fsd f12, 12*8(%1)\n"
+        "fsd f13, 13*8(%1)\n"
+        "fsd f14, 14*8(%1)\n"
+        "fsd f15, 15*8(%1)\n"
+        "fsd f16, 16*8(%1)\n"
+        "fsd f17, 17*8(%1)\n"
+        "fsd f18, 18*8(%1)\n"
+        "fsd f19, 19*8(%1)\n"
+        "fsd f20, 20*8(%1)\n"
+        "fsd f21, 21*8(%1)\n"
+        "fsd f22, 22*8(%1)\n"
+        "fsd f23, 23*8(%1)\n"
+        "fsd f24, 24*8(%1)\n"
+        "fsd f25, 25*8(%1)\n"
+        "fsd f26, 26*8(%1)\n"
+        "fsd f27, 27*8(%1)\n"
+        "fsd f28, 28*8(%1)\n"
+        "fsd f29, 29*8(%1)\n"
+        "fsd f30, 30*8(%1)\n"
+        "fsd f31, 31*8(%1)\n"
+        "frcsr t0\n"
+        "sd t0, 32*8(%1)\n"
+        : : "r"(in), "r"(out), "i"(SYS_yield)
+        : "t0", "a0", "memory");
+}
+
+static void
+fp_fill(struct fp_regs *regs, int id, int round) {
+    int i;
+    for (i = 0; i < 32; i ++) {
+        regs->f[i] = (uint64_t)(id + 1) << 48 | (uint64_t)i << 32 | round;
+    }
+    // a rounding mode (0 - 4) and the accrued exception flags
+    regs->fcsr = ((id + round) % 5) << 5 | (round & 0x1f);
+}
+
+static int
+worker(int id) {
+    struct fp_regs in, out;
+    int round, i;
+    double x = 0.0;
+    for (round = 0; round < ROUNDS; round ++) {
+        fp_fill(&in, id, round);
+        fp_yield(&in, &out);
+        for (i = 0; i < 32; i ++) {
+            if (in.f[i] != out.f[i]) {
+                cprintf("fptest: pid %d round %d: f%d is %lx, not %lx\n", getpid(), round, i, out.f[i], in.f[i]);
+                return -1;
+            }
+        }
+        if (in.fcsr != out.fcsr) {
+            cprintf("fptest: pid %d round %d: fcsr is %lx, not %lx\n", getpid(), round, out.fcsr, in.fcsr);
+            return -1;
+        }
+        // exact whatever the rounding mode, so it must come out right
+        x += 0.5;
+    }
+    return (x == ROUNDS * 0.5) ? 0 : -1;
+}
+
+int
+main(void) {
+    int pids[NR_PROCS], i, code;
+
+    // fork inherits the FP state
+    uint64_t frm = 2, child_frm;
+    __asm__ __volatile__("fsrm %0" : : "r"(frm));
+    if ((pids[0] = fork()) == 0) {
+        __asm__ __volatile__("frrm %0" : "=r"(child_frm));
+        exit(child_frm == frm ? 0 : -1);
+    }
+    assert(pids[0] > 0 && waitpid(pids[0], &code) == 0 && code == 0);
+
+    for (i = 0; i < NR_PROCS; i ++) {
+        if ((pids[i] = fork()) == 0) {
+            exit(worker(i));
+        }
+        assert(pids[i] > 0);
+    }
+    for (i = 0; i < NR_PROCS; i ++) {
+        assert(waitpid(pids[i], &code) == 0 && code == 0);
+    }
+    cprintf("fptest pass.\n");
+    return 0;
+}
+
@@ -0,0 +1,155 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <atomic.h>
+#include <lock.h>
+#include <cond.h>
+#include <sem.h>
+#include <thread.h>
+
+/* *
+ * futexbench - user locks on futexes, against the yield/sleep spin lock
+ * lock.h used to be. Threads hammer a counter under each lock, bounce a
+ * token between two threads through a pair of semaphores to time one
+ * handoff, and pass items through a one-slot buffer guarded by a lock and
+ * two condition variables.
+ * */
+
+#define NR_THREADS      4
+#define INCS            2000
+#define ROUNDS          1000
+#define ITEMS           1000
+
+// the old lock: test_and_set_bit, yield, and sleep(10) every 100 spins
+static inline void
+yield_lock(volatile unsigned long *l) {
+    int step = 0;
+    while (test_and_set_bit(0, l)) {
+        yield();
+        if (++ step == 100) {
+            step = 0;
+            sleep(10);
+        }
+    }
+}
+
+static inline void
+yield_unlock(volatile unsigned long *l) {
+    test_and_clear_bit(0, l);
+}
+
+static char stacks[NR_THREADS][THREAD_STACK_SIZE] __attribute__((aligned(16)));
+static lock_t counter_lock = INIT_LOCK;
+static volatile unsigned long counter_yield_lock;
+static volatile int counter;
+
+static int
+futex_counter(void *arg) {
+    int i;
+    for (i = 0; i < INCS; i ++) {
+        lock(&counter_lock);
+        counter ++;
+        unlock(&counter_lock);
+    }
+    return 0;
+}
+
+static int
+yield_counter(void *arg) {
+    int i;
+    for (i = 0; i < INCS; i ++) {
+        yield_lock(&counter_yield_lock);
+        counter ++;
+        yield_unlock(&counter_yield_lock);
+    }
+    return 0;
+}
+
+// run_threads - run fn in NR_THREADS threads, return the msecs it took
+static unsigned int
+run_threads(int (*fn)(void *), void *arg, int nr) {
+    thread_t threads[NR_THREADS];
+    int i, code;
+    unsigned int time = gettime_msec();
+    for (i = 0; i < nr; i ++) {
+        assert(thread_create(threads + i, stacks[i], THREAD_STACK_SIZE, fn, arg) == 0);
+    }
+    for (i = 0; i < nr; i ++) {
+        assert(thread_join(threads + i, &code) == 0 && code == 0);
+    }
+    return gettime_msec() - time;
+}
+
+static sem_t ping = INIT_SEM(0), pong = INIT_SEM(0);
+
+static int
+ponger(void *arg) {
+    int i;
+    for (i = 0; i < ROUNDS; i ++) {
+        sem_wait(&ping);
+        sem_post(&pong);
+    }
+    return 0;
+}
+
+static lock_t slot_lock = INIT_LOCK;
+static cond_t slot_empty = INIT_COND, slot_full = INIT_COND;
+static bool slot_used;
+static int slot;
+
+static int
+consumer(void *arg) {
+    int i, sum = 0;
+    for (i = 0; i < ITEMS; i ++) {
+        lock(&slot_lock);
+        while (!slot_used) {
+            cond_wait(&slot_full, &slot_lock);
+        }
+        sum += slot, slot_used = 0;
+        cond_signal(&slot_empty);
+        unlock(&slot_lock);
+    }
+    return (sum == ITEMS * (ITEMS + 1) / 2) ? 0 : -1;
+}
+
+int
+main(void) {
+    thread_t thread;
+    int i, code;
+
+    counter = 0;
+    unsigned int futex_time = run_threads(futex_counter, NULL, NR_THREADS);
+    assert(counter == NR_THREADS * INCS);
+    counter = 0;
+    unsigned int yield_time = run_threads(yield_counter, NULL, NR_THREADS);
+    assert(counter == NR_THREADS * INCS);
+    cprintf("futexbench: %d threads x %d locked incs: futex lock %d msecs, yield lock %d msecs.\n",
+            NR_THREADS, INCS, futex_time, yield_time);
+
+    unsigned int time = gettime_msec();
+    assert(thread_create(&thread, stacks[0], THREAD_STACK_SIZE, ponger, NULL) == 0);
+    for (i = 0; i < ROUNDS; i ++) {
+        sem_post(&ping);
+        sem_wait(&pong);
+    }
+    assert(thread_join(&thread, &code) == 0 && code == 0);
+    time = gettime_msec() - time;
+    cprintf("futexbench: %d semaphore round trips: %d msecs, %d usecs a handoff.\n",
+            ROUNDS, time, time * 1000 / (2 * ROUNDS));
+
+    assert(thread_create(&thread, stacks[0], THREAD_STACK_SIZE, consumer, NULL) == 0);
+    for (i = 1; i <= ITEMS; i ++) {
+        lock(&slot_lock);
+        while (slot_used) {
+            cond_wait(&slot_empty, &slot_lock);
+        }
+        slot = i, slot_used = 1;
+        cond_signal(&slot_full);
+        unlock(&slot_lock);
+    }
+    assert(thread_join(&thread, &code) == 0 && code == 0);
+    cprintf("futexbench: %d items through a condition variable.\n", ITEMS);
+
+    cprintf("futexbench pass.\n");
+    return 0;
+}
+
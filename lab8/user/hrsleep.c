@@ -0,0 +1,41 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <time.h>
+
+/* *
+ * hrsleep - precision of nanosleep.
+ * Sleeps ROUNDS times for each of a few durations well below the 10ms
+ * tick and reports how much longer than requested each sleep took,
+ * measured with clock_gettime(CLOCK_MONOTONIC).
+ * */
+
+#define ROUNDS          50
+
+static uint64_t over[ROUNDS];
+static const uint64_t durations[] = {100 * NSEC_PER_USEC, NSEC_PER_MSEC, 3 * NSEC_PER_MSEC};
+
+int
+main(void) {
+    int i, d;
+    struct timespec req;
+    assert(clock_gettime(CLOCK_MONOTONIC + 1, &req) != 0);
+    req.tv_sec = 0, req.tv_nsec = NSEC_PER_SEC;
+    assert(nanosleep(&req, NULL) != 0);
+
+    for (d = 0; d < sizeof(durations) / sizeof(durations[0]); d ++) {
+        ns_to_timespec(durations[d], &req);
+        for (i = 0; i < ROUNDS; i ++) {
+            uint64_t start = now_ns();
+            assert(nanosleep(&req, NULL) == 0);
+            uint64_t slept = now_ns() - start;
+            assert(slept >= durations[d]);
+            over[i] = slept - durations[d];
+        }
+        sort_u64(over, ROUNDS);
+        cprintf("hrsleep: %6d us, late by p50 %d us, p99 %d us, max %d us\n",
+                (int)(durations[d] / NSEC_PER_USEC), (int)(over[ROUNDS / 2] / NSEC_PER_USEC),
+                (int)(over[ROUNDS * 99 / 100] / NSEC_PER_USEC), (int)(over[ROUNDS - 1] / NSEC_PER_USEC));
+    }
+    cprintf("hrsleep pass.\n");
+    return 0;
+}
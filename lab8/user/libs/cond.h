@@ -0,0 +1,50 @@
+#ifndef __USER_LIBS_COND_H__
+#define __USER_LIBS_COND_H__
+
+#include <defs.h>
+#include <atomic.h>
+#include <ulib.h>
+#include <unistd.h>
+#include <lock.h>
+
+/* *
+ * cond - a condition variable on a futex. The word is a sequence number
+ * bumped by every signal: a waiter that finds it changed between dropping
+ * the lock and going to sleep does not sleep, so no signal is lost. As
+ * usual, a waiter must check its condition again after cond_wait.
+ * */
+
+#define INIT_COND           {0}
+
+typedef struct {
+    volatile int seq;
+} cond_t;
+
+static inline void
+cond_init(cond_t *c) {
+    c->seq = 0;
+}
+
+// cond_wait - release @l and sleep until signalled, then take @l again
+static inline void
+cond_wait(cond_t *c, lock_t *l) {
+    int seq = c->seq;
+    unlock(l);
+    futex_wait(&(c->seq), seq);
+    lock(l);
+}
+
+static inline void
+cond_signal(cond_t *c) {
+    atomic_fetch_add(&(c->seq), 1);
+    futex_wake(&(c->seq), 1);
+}
+
+static inline void
+cond_broadcast(cond_t *c) {
+    atomic_fetch_add(&(c->seq), 1);
+    futex_wake(&(c->seq), FUTEX_WAKE_ALL);
+}
+
+#endif /* !__USER_LIBS_COND_H__ */
+
@@ -5,37 +5,51 @@
 #include <atomic.h>
 #include <ulib.h>
 
-#define INIT_LOCK           {0}
+/* *
+ * lock - a mutex on a futex. The word is 0 when free, 1 when held, and 2
+ * when held with (maybe) sleepers, so an unlock makes a system call only
+ * if somebody went to sleep on it.
+ * */
 
-typedef volatile bool lock_t;
+#define INIT_LOCK           0
+
+#define LOCK_FREE           0
+#define LOCK_HELD           1
+#define LOCK_WAITERS        2
+
+typedef volatile int lock_t;
 
 static inline void
 lock_init(lock_t *l) {
-    *l = 0;
+    *l = LOCK_FREE;
 }
 
+// try_lock - take @l if it is free, return true if it was held
 static inline bool
 try_lock(lock_t *l) {
-    return test_and_set_bit(0, l);
+    return atomic_cmpxchg(l, LOCK_FREE, LOCK_HELD) != LOCK_FREE;
 }
 
 static inline void
 lock(lock_t *l) {
-    if (try_lock(l)) {
-        int step = 0;
-        do {
-            yield();
-            if (++ step == 100) {
-                step = 0;
-                sleep(10);
-            }
-        } while (try_lock(l));
+    int c;
+    if ((c = atomic_cmpxchg(l, LOCK_FREE, LOCK_HELD)) != LOCK_FREE) {
+        // mark it contended, and sleep until it is released
+        if (c != LOCK_WAITERS) {
+            c = atomic_xchg(l, LOCK_WAITERS);
+        }
+        while (c != LOCK_FREE) {
+            futex_wait(l, LOCK_WAITERS);
+            c = atomic_xchg(l, LOCK_WAITERS);
+        }
     }
 }
 
 static inline void
 unlock(lock_t *l) {
-    test_and_clear_bit(0, l);
+    if (atomic_xchg(l, LOCK_FREE) == LOCK_WAITERS) {
+        futex_wake(l, 1);
+    }
 }
 
 #endif /* !__USER_LIBS_LOCK_H__ */
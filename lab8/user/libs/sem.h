@@ -0,0 +1,57 @@
+#ifndef __USER_LIBS_SEM_H__
+#define __USER_LIBS_SEM_H__
+
+#include <defs.h>
+#include <atomic.h>
+#include <ulib.h>
+
+/* *
+ * sem - a counting semaphore on a futex. sem_wait sleeps on the count
+ * while it is 0; sem_post makes a system call only if somebody may be
+ * asleep, which the waiters count tells.
+ * */
+
+#define INIT_SEM(value)     {(value), 0}
+
+typedef struct {
+    volatile int value;
+    volatile int waiters;
+} sem_t;
+
+static inline void
+sem_init(sem_t *s, int value) {
+    s->value = value;
+    s->waiters = 0;
+}
+
+// sem_trywait - take one if the count is not 0, return true on success
+static inline bool
+sem_trywait(sem_t *s) {
+    int v;
+    while ((v = s->value) > 0) {
+        if (atomic_cmpxchg(&(s->value), v, v - 1) == v) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static inline void
+sem_wait(sem_t *s) {
+    while (!sem_trywait(s)) {
+        atomic_fetch_add(&(s->waiters), 1);
+        futex_wait(&(s->value), 0);
+        atomic_fetch_add(&(s->waiters), -1);
+    }
+}
+
+static inline void
+sem_post(sem_t *s) {
+    atomic_fetch_add(&(s->value), 1);
+    if (s->waiters > 0) {
+        futex_wake(&(s->value), 1);
+    }
+}
+
+#endif /* !__USER_LIBS_SEM_H__ */
+
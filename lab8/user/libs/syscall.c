@@ -45,6 +45,11 @@ sys_exit(int64_t error_code) {
     return syscall(SYS_exit, error_code);
 }
 
+int
+sys_exit_thread(int64_t error_code) {
+    return syscall(SYS_exit_thread, error_code);
+}
+
 int
 sys_fork(void) {
     return syscall(SYS_fork);
@@ -86,6 +91,11 @@ sys_lab6_set_priority(uint64_t priority)
     syscall(SYS_lab6_set_priority, priority);
 }
 
+int
+sys_sched_setscheduler(int64_t pid, int64_t policy, int64_t priority) {
+    return syscall(SYS_sched_setscheduler, pid, policy, priority);
+}
+
 int
 sys_sleep(int64_t time) {
     return syscall(SYS_sleep, time);
@@ -96,6 +106,26 @@ sys_gettime(void) {
     return syscall(SYS_gettime);
 }
 
+int
+sys_nanosleep(const struct timespec *req, struct timespec *rem) {
+    return syscall(SYS_nanosleep, req, rem);
+}
+
+int
+sys_clock_gettime(int64_t clock_id, struct timespec *tp) {
+    return syscall(SYS_clock_gettime, clock_id, tp);
+}
+
+int
+sys_getrusage(int64_t who, struct rusage *usage) {
+    return syscall(SYS_getrusage, who, usage);
+}
+
+int
+sys_futex(volatile int *uaddr, int64_t op, int64_t val) {
+    return syscall(SYS_futex, uaddr, op, val);
+}
+
 int
 sys_exec(const char *name, int64_t argc, const char **argv) {
     return syscall(SYS_exec, name, argc, argv);
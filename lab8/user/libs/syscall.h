@@ -2,6 +2,7 @@
 #define __USER_LIBS_SYSCALL_H__
 
 int sys_exit(int64_t error_code);
+int sys_exit_thread(int64_t error_code);
 int sys_fork(void);
 int sys_wait(int64_t pid, int64_t *store);
 int sys_exec(const char *name, int64_t argc, const char **argv);
@@ -12,6 +13,17 @@ int sys_putc(int64_t c);
 int sys_pgdir(void);
 int sys_sleep(int64_t time);
 int sys_gettime(void);
+int sys_sched_setscheduler(int64_t pid, int64_t policy, int64_t priority);
+
+struct timespec;
+
+int sys_nanosleep(const struct timespec *req, struct timespec *rem);
+int sys_clock_gettime(int64_t clock_id, struct timespec *tp);
+int sys_futex(volatile int *uaddr, int64_t op, int64_t val);
+
+struct rusage;
+
+int sys_getrusage(int64_t who, struct rusage *usage);
 
 struct stat;
 struct dirent;
@@ -0,0 +1,88 @@
+#include <defs.h>
+#include <unistd.h>
+#include <syscall.h>
+#include <string.h>
+#include <error.h>
+#include <ulib.h>
+#include <thread.h>
+
+int __clone(uint32_t clone_flags, uintptr_t stack, uintptr_t tls, int (*fn)(void *), void *arg);
+
+#define THREAD_CLONE_FLAGS      (CLONE_VM | CLONE_FS | CLONE_THREAD | CLONE_SETTLS)
+#define THREAD_STACK_MIN        4096        // the tcb and a few frames
+
+static struct thread_tcb main_tcb;
+
+// thread_tcb - the tcb of the running thread; tp is 0 after exec, then it is the main thread
+static inline struct thread_tcb *
+thread_tcb(void) {
+    struct thread_tcb *tcb;
+    asm volatile ("mv %0, tp" : "=r"(tcb));
+    if (tcb == NULL) {
+        tcb = main_tcb.self = &main_tcb;
+        asm volatile ("mv tp, %0" : : "r"(tcb));
+    }
+    return tcb;
+}
+
+// thread_create - run fn(arg) in a new thread on @stack, return 0 and fill in @thread on success
+int
+thread_create(thread_t *thread, void *stack, size_t stack_size, int (*fn)(void *), void *arg) {
+    int tid;
+    if (stack_size < THREAD_STACK_MIN) {
+        return -E_INVAL;
+    }
+    uintptr_t top = ROUNDDOWN((uintptr_t)stack + stack_size, 16);
+    struct thread_tcb *tcb = (struct thread_tcb *)ROUNDDOWN(top - sizeof(struct thread_tcb), 16);
+    memset(tcb, 0, sizeof(struct thread_tcb));
+    tcb->self = tcb;
+
+    if ((tid = __clone(THREAD_CLONE_FLAGS, (uintptr_t)tcb, (uintptr_t)tcb, fn, arg)) < 0) {
+        return tid;
+    }
+    thread->tid = tid, thread->tcb = tcb;
+    return 0;
+}
+
+// thread_join - wait for @thread to exit and get its exit code, its stack may be reused then
+int
+thread_join(thread_t *thread, int *exit_code) {
+    int ret;
+    if (thread->tcb == NULL) {
+        return -E_INVAL;
+    }
+    if ((ret = waitpid(thread->tid, exit_code)) == 0) {
+        thread->tcb = NULL;
+    }
+    return ret;
+}
+
+void
+thread_exit(int exit_code) {
+    sys_exit_thread(exit_code);
+    panic("BUG: thread_exit returned.\n");
+}
+
+// thread_self - a thread is a process of its own, its tid is its pid
+int
+thread_self(void) {
+    return getpid();
+}
+
+void *
+thread_getspecific(int key) {
+    if (key < 0 || key >= THREAD_KEYS) {
+        return NULL;
+    }
+    return thread_tcb()->keys[key];
+}
+
+int
+thread_setspecific(int key, void *value) {
+    if (key < 0 || key >= THREAD_KEYS) {
+        return -E_INVAL;
+    }
+    thread_tcb()->keys[key] = value;
+    return 0;
+}
+
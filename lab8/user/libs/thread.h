@@ -0,0 +1,41 @@
+#ifndef __USER_LIBS_THREAD_H__
+#define __USER_LIBS_THREAD_H__
+
+#include <defs.h>
+
+/* *
+ * threads - processes sharing the address space and the files of their
+ * creator, made with SYS_clone. Each has a thread control block that tp
+ * points to, which holds its thread-local storage.
+ *
+ * There is no mmap: the caller gives each thread its stack, and the tcb
+ * is put at the top of it. The stack must stay untouched until the thread
+ * is joined. The main thread's tcb is set up by the first thread call.
+ *
+ * Only the creator of a thread may join it (it is the parent, and joining
+ * is waitpid). exit ends the whole process with all its threads,
+ * thread_exit or returning from the thread function ends just one.
+ * */
+
+#define THREAD_STACK_SIZE       16384       // a suggested stack size
+#define THREAD_KEYS             8           // thread-local slots
+
+struct thread_tcb {
+    struct thread_tcb *self;                // tp points here
+    void *keys[THREAD_KEYS];
+};
+
+typedef struct {
+    int tid;
+    struct thread_tcb *tcb;                 // at the top of its stack, NULL once joined
+} thread_t;
+
+int thread_create(thread_t *thread, void *stack, size_t stack_size, int (*fn)(void *), void *arg);
+int thread_join(thread_t *thread, int *exit_code);
+void __noreturn thread_exit(int exit_code);
+int thread_self(void);
+void *thread_getspecific(int key);
+int thread_setspecific(int key, void *value);
+
+#endif /* !__USER_LIBS_THREAD_H__ */
+
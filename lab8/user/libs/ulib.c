@@ -4,6 +4,9 @@
 #include <ulib.h>
 #include <stat.h>
 #include <lock.h>
+#include <unistd.h>
+#include <time.h>
+
 void
 exit(int error_code) {
     sys_exit(error_code);
@@ -62,6 +65,59 @@ int
 sleep(unsigned int time) {
     return sys_sleep(time);
 }
+
+int
+nanosleep(const struct timespec *req, struct timespec *rem) {
+    return sys_nanosleep(req, rem);
+}
+
+int
+clock_gettime(int clock_id, struct timespec *tp) {
+    return sys_clock_gettime(clock_id, tp);
+}
+
+// now_ns - CLOCK_MONOTONIC in nsecs, for the latency benchmarks
+uint64_t
+now_ns(void) {
+    struct timespec ts;
+    assert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+    return timespec_to_ns(&ts);
+}
+
+// sort_u64 - sort @a in ascending order, insertion sort for the small sample arrays of the benchmarks
+void
+sort_u64(uint64_t *a, int n) {
+    int i, j;
+    for (i = 1; i < n; i ++) {
+        uint64_t key = a[i];
+        for (j = i; j > 0 && a[j - 1] > key; j --) {
+            a[j] = a[j - 1];
+        }
+        a[j] = key;
+    }
+}
+
+int
+getrusage(int who, struct rusage *usage) {
+    return sys_getrusage(who, usage);
+}
+
+// futex_wait - sleep until woken up if *@uaddr is still @val
+int
+futex_wait(volatile int *uaddr, int val) {
+    return sys_futex(uaddr, FUTEX_WAIT, val);
+}
+
+// futex_wake - wake up at most @nr sleepers on @uaddr
+int
+futex_wake(volatile int *uaddr, int nr) {
+    return sys_futex(uaddr, FUTEX_WAKE, nr);
+}
+
+int
+sched_setscheduler(int pid, int policy, int priority) {
+    return sys_sched_setscheduler(pid, policy, priority);
+}
 int
 __exec(const char *name, const char **argv) {
     int argc = 0;
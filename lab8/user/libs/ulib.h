@@ -25,6 +25,8 @@ void __noreturn __panic(const char *file, int line, const char *fmt, ...);
 
 void __noreturn exit(int error_code);
 int fork(void);
+// vfork - the child may only call exec or exit, not return from the caller of vfork
+int vfork(void) __attribute__((returns_twice));
 int wait(void);
 int waitpid(int pid, int *store);
 void yield(void);
@@ -34,6 +36,20 @@ void print_pgdir(void);
 unsigned int gettime_msec(void);
 void lab6_set_priority(uint32_t priority);
 int sleep(unsigned int time);
+int sched_setscheduler(int pid, int policy, int priority);
+
+struct timespec;
+
+int nanosleep(const struct timespec *req, struct timespec *rem);
+int clock_gettime(int clock_id, struct timespec *tp);
+uint64_t now_ns(void);
+void sort_u64(uint64_t *a, int n);
+int futex_wait(volatile int *uaddr, int val);
+int futex_wake(volatile int *uaddr, int nr);
+
+struct rusage;
+
+int getrusage(int who, struct rusage *usage);
 int fprintf(int fd, const char *fmt, ...);
 int __exec(const char *name, const char **argv);
 #endif /* !__USER_LIBS_ULIB_H__ */
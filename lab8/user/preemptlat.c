@@ -0,0 +1,79 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <file.h>
+#include <time.h>
+#include <resource.h>
+#include <unistd.h>
+
+/* *
+ * preemptlat - wakeup latency of a real-time process while others are
+ * busy in the kernel. NR_LOADERS children keep forking with a large mm
+ * (copy_range and unmap_range of every page) and reading a file with one
+ * big read; the SCHED_FIFO parent sleeps 1ms ROUNDS times and records how
+ * late it got the cpu back. Run it with make qemu PREEMPT=0 and PREEMPT=1
+ * (and SMP=1): without kernel preemption the worst case is as long as the
+ * longest fork or read, with it a few microseconds of copying.
+ * */
+
+#define NR_LOADERS      2
+#define ROUNDS          200
+#define RT_PRIO         10
+#define BIGMEM_SIZE     (4 * 1024 * 1024)
+#define READ_SIZE       (256 * 1024)
+#define READ_FILE       "/sh"
+
+static char bigmem[BIGMEM_SIZE];
+static char readbuf[READ_SIZE];
+static uint64_t over[ROUNDS];
+
+static void
+loader(void) {
+    int i, pid, fd;
+    for (i = 0; i < BIGMEM_SIZE; i += 4096) {
+        bigmem[i] = i;
+    }
+    while (1) {
+        if ((pid = fork()) == 0) {
+            exit(0);
+        }
+        assert(pid > 0 && waitpid(pid, NULL) == 0);
+        assert((fd = open(READ_FILE, O_RDONLY)) >= 0);
+        while (read(fd, readbuf, READ_SIZE) > 0)
+            /* nothing */ ;
+        close(fd);
+    }
+}
+
+int
+main(void) {
+    int i, pids[NR_LOADERS];
+    for (i = 0; i < NR_LOADERS; i ++) {
+        if ((pids[i] = fork()) == 0) {
+            loader();
+        }
+        assert(pids[i] > 0);
+    }
+
+    assert(sched_setscheduler(0, SCHED_FIFO, RT_PRIO) == 0);
+    struct timespec req;
+    ns_to_timespec(NSEC_PER_MSEC, &req);
+    for (i = 0; i < ROUNDS; i ++) {
+        uint64_t start = now_ns();
+        assert(nanosleep(&req, NULL) == 0);
+        over[i] = now_ns() - start - NSEC_PER_MSEC;
+    }
+    struct rusage ru;
+    assert(getrusage(RUSAGE_SELF, &ru) == 0);
+    assert(sched_setscheduler(0, SCHED_NORMAL, 0) == 0);
+
+    for (i = 0; i < NR_LOADERS; i ++) {
+        assert(kill(pids[i]) == 0 && waitpid(pids[i], NULL) == 0);
+    }
+
+    sort_u64(over, ROUNDS);
+    cprintf("preemptlat: late by p50 %d us, p99 %d us, max %d us, longest run queue wait %d us\n",
+            (int)(over[ROUNDS / 2] / NSEC_PER_USEC), (int)(over[ROUNDS * 99 / 100] / NSEC_PER_USEC),
+            (int)(over[ROUNDS - 1] / NSEC_PER_USEC), (int)(timespec_to_ns(&ru.ru_rqdelay_max) / NSEC_PER_USEC));
+    cprintf("preemptlat pass.\n");
+    return 0;
+}
@@ -24,6 +24,7 @@ spin_delay(void)
 int
 main(void) {
      int i,time;
+     unsigned int total = 0;
      memset(pids, 0, sizeof(pids));
      lab6_set_priority(TOTAL + 1);
 
@@ -55,8 +56,11 @@ main(void) {
          status[i]=0;
          waitpid(pids[i],&status[i]);
          cprintf("main: pid %d, acc %d, time %d\n",pids[i],status[i],gettime_msec()); 
+         total += status[i];
      }
      cprintf("main: wait pids over\n");
+     // the throughput of the scheduler, compare with make qemu SCHED=RR/CFS
+     cprintf("main: total acc %d\n", total);
      cprintf("stride sched correct result:");
      for (i = 0; i < TOTAL; i ++)
      {
@@ -0,0 +1,60 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <file.h>
+#include <unistd.h>
+
+/* *
+ * readbench - several processes reading the same file. NR_READERS
+ * children each read READ_FILE from start to end ROUNDS times with
+ * BUFSIZE reads, while the inode is shared between their reads. Compare
+ * the total with NR_READERS 1 for the cost of sharing the file, and run
+ * it with SMP=1 and SMP=4.
+ * */
+
+#define NR_READERS      4
+#define ROUNDS          20
+#define BUFSIZE         4096
+#define READ_FILE       "/sh"
+
+static char buffer[BUFSIZE];
+
+static int
+reader(void) {
+    int round, fd, ret, size, first = -1;
+    for (round = 0; round < ROUNDS; round ++) {
+        if ((fd = open(READ_FILE, O_RDONLY)) < 0) {
+            return 1;
+        }
+        size = 0;
+        while ((ret = read(fd, buffer, BUFSIZE)) > 0) {
+            size += ret;
+        }
+        close(fd);
+        // every round must see the whole file
+        if (ret < 0 || (first >= 0 && size != first)) {
+            return 1;
+        }
+        first = size;
+    }
+    return 0;
+}
+
+int
+main(void) {
+    int pids[NR_READERS], i, code;
+    unsigned int time = gettime_msec();
+    for (i = 0; i < NR_READERS; i ++) {
+        if ((pids[i] = fork()) == 0) {
+            exit(reader());
+        }
+        assert(pids[i] > 0);
+    }
+    for (i = 0; i < NR_READERS; i ++) {
+        assert(waitpid(pids[i], &code) == 0 && code == 0);
+    }
+    time = gettime_msec() - time;
+    cprintf("readbench: %d readers x %d reads of %s: %d msecs.\n", NR_READERS, ROUNDS, READ_FILE, time);
+    cprintf("readbench pass.\n");
+    return 0;
+}
+
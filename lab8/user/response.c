@@ -0,0 +1,60 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/* *
+ * response - wakeup latency of an interactive process under CPU load.
+ * NR_HOGS children spin forever while the parent sleeps SLEEP_TICKS ticks
+ * ROUNDS times and records how much later than requested it got the CPU
+ * back, first as a normal process and then as SCHED_FIFO. Build the
+ * kernel with "make SCHED=RR" or "make SCHED=MLFQ" to compare the
+ * scheduler classes.
+ * */
+
+#define NR_HOGS         4
+#define ROUNDS          50
+#define SLEEP_TICKS     2
+#define TICK_MSEC       10
+#define RT_PRIO         10
+
+static uint64_t lat[ROUNDS];
+
+static void
+measure(const char *name) {
+    int i;
+    for (i = 0; i < ROUNDS; i ++) {
+        unsigned int time = gettime_msec();
+        sleep(SLEEP_TICKS);
+        time = gettime_msec() - time;
+        lat[i] = (time > SLEEP_TICKS * TICK_MSEC) ? time - SLEEP_TICKS * TICK_MSEC : 0;
+    }
+    sort_u64(lat, ROUNDS);
+    cprintf("response: %-10s p50 %d, p90 %d, p99 %d, max %d msecs\n", name, (int)lat[ROUNDS / 2],
+            (int)lat[ROUNDS * 9 / 10], (int)lat[ROUNDS * 99 / 100], (int)lat[ROUNDS - 1]);
+}
+
+int
+main(void) {
+    int i, pids[NR_HOGS];
+    assert(sched_setscheduler(0, SCHED_FIFO, 0) != 0);
+    assert(sched_setscheduler(0, SCHED_NORMAL, 1) != 0);
+
+    for (i = 0; i < NR_HOGS; i ++) {
+        if ((pids[i] = fork()) == 0) {
+            while (1);
+        }
+        assert(pids[i] > 0);
+    }
+
+    cprintf("response: wakeup latency with %d hogs:\n", NR_HOGS);
+    measure("normal");
+    assert(sched_setscheduler(0, SCHED_FIFO, RT_PRIO) == 0);
+    measure("SCHED_FIFO");
+    assert(sched_setscheduler(0, SCHED_NORMAL, 0) == 0);
+
+    for (i = 0; i < NR_HOGS; i ++) {
+        assert(kill(pids[i]) == 0 && waitpid(pids[i], NULL) == 0);
+    }
+    cprintf("response pass.\n");
+    return 0;
+}
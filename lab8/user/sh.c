@@ -113,10 +113,41 @@ testfile(const char *name) {
     return 0;
 }
 
+static char argv0[BUFSIZE];
+static const char *argv[EXEC_MAX_ARG_NUM + 1];//must be static!
+
+// runit - exec the command in argv[0 .. argc), return if it is a builtin or exec fails
+static int
+runit(int argc) {
+    int ret;
+    if (argc == 0) {
+        return 0;
+    }
+    else if (strcmp(argv[0], "cd") == 0) {
+        if (argc != 2) {
+            return -1;
+        }
+        strcpy(shcwd, argv[1]);
+        return 0;
+    }
+    if ((ret = testfile(argv[0])) != 0) {
+        if (ret != -E_NOENT) {
+            return ret;
+        }
+        snprintf(argv0, sizeof(argv0), "/%s", argv[0]);
+        argv[0] = argv0;
+    }
+    argv[argc] = NULL;
+    return __exec(argv[0], argv);
+}
+
+/* *
+ * runcmd - parse and run @cmd. The commands before a ';' run in a vfork
+ * child, which must exec or exit and never return from here: the parent
+ * sleeps on this same stack frame until then.
+ * */
 int
 runcmd(char *cmd) {
-    static char argv0[BUFSIZE];
-    static const char *argv[EXEC_MAX_ARG_NUM + 1];//must be static!
     char *t;
     int argc, token, ret, p[2];
 again:
@@ -169,14 +200,14 @@ again:
                     return ret;
                 }
                 close(p[0]), close(p[1]);
-                goto runit;
+                return runit(argc);
             }
             break;
         case 0:
-            goto runit;
+            return runit(argc);
         case ';':
-            if ((ret = fork()) == 0) {
-                goto runit;
+            if ((ret = vfork()) == 0) {
+                exit(runit(argc));
             }
             else {
                 if (ret < 0) {
@@ -191,27 +222,6 @@ again:
             return -1;
         }
     }
-
-runit:
-    if (argc == 0) {
-        return 0;
-    }
-    else if (strcmp(argv[0], "cd") == 0) {
-        if (argc != 2) {
-            return -1;
-        }
-        strcpy(shcwd, argv[1]);
-        return 0;
-    }
-    if ((ret = testfile(argv[0])) != 0) {
-        if (ret != -E_NOENT) {
-            return ret;
-        }
-        snprintf(argv0, sizeof(argv0), "/%s", argv[0]);
-        argv[0] = argv0;
-    }
-    argv[argc] = NULL;
-    return __exec(argv[0], argv);
 }
 
 int
@@ -235,7 +245,8 @@ main(int argc, char **argv) {
     while ((buffer = readline((interactive) ? "$ " : NULL)) != NULL) {
         shcwd[0] = '\0';
         int pid;
-        if ((pid = fork()) == 0) {
+        // runcmd ends in an exec, no need to copy the address space for it
+        if ((pid = vfork()) == 0) {
             ret = runcmd(buffer);
             exit(ret);
         }
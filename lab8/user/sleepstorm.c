@@ -0,0 +1,46 @@
+#include <ulib.h>
+#include <stdio.h>
+
+/* *
+ * sleepstorm - thousands of concurrent sleepers on the timer wheel.
+ * Forks up to NR_SLEEPERS children (fewer if memory runs out), each sleeps
+ * a different time between SLEEP_MIN and SLEEP_MIN + SLEEP_SPREAD ticks
+ * and exits with how many msecs later than requested it woke up.
+ * */
+
+#define NR_SLEEPERS     1000
+#define SLEEP_MIN       200
+#define SLEEP_SPREAD    300
+#define TICK_MSEC       10
+
+static int pids[NR_SLEEPERS];
+
+int
+main(void) {
+    int i, n, code, max_late = 0, total_late = 0;
+    unsigned int time = gettime_msec();
+    for (n = 0; n < NR_SLEEPERS; n ++) {
+        if ((pids[n] = fork()) == 0) {
+            unsigned int ticks = SLEEP_MIN + (n * 7) % SLEEP_SPREAD;
+            unsigned int start = gettime_msec();
+            sleep(ticks);
+            int late = (int)(gettime_msec() - start) - ticks * TICK_MSEC;
+            exit(late > 0 ? late : 0);
+        }
+        if (pids[n] < 0) {
+            break;
+        }
+    }
+    cprintf("sleepstorm: %d sleepers forked in %d msecs.\n", n, gettime_msec() - time);
+    assert(n > 0);
+
+    for (i = 0; i < n; i ++) {
+        assert(waitpid(pids[i], &code) == 0);
+        total_late += code;
+        max_late = (code > max_late) ? code : max_late;
+    }
+    cprintf("sleepstorm: woke up late by %d msecs on average, %d at most.\n",
+            total_late / n, max_late);
+    cprintf("sleepstorm pass.\n");
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <ulib.h>
+#include <stdio.h>
+
+/* *
+ * smpbench - cpu-bound throughput across harts.
+ * NR_WORKERS children each multiply matrices for a fixed amount of work
+ * with no system calls in between. Run it with make qemu SMP=1, 2 and 4:
+ * the wall time should drop close to 1/n as long as NR_WORKERS >= n,
+ * since the kernel lock is not taken while they compute.
+ * */
+
+#define NR_WORKERS      4
+#define MATSIZE         16
+#define ROUNDS          400
+
+static int mata[MATSIZE][MATSIZE];
+static int matb[MATSIZE][MATSIZE];
+static int matc[MATSIZE][MATSIZE];
+
+static int
+work(int seed) {
+    int i, j, k, round;
+    for (i = 0; i < MATSIZE; i ++) {
+        for (j = 0; j < MATSIZE; j ++) {
+            mata[i][j] = seed + i;
+            matb[i][j] = seed + j;
+        }
+    }
+    for (round = 0; round < ROUNDS; round ++) {
+        for (i = 0; i < MATSIZE; i ++) {
+            for (j = 0; j < MATSIZE; j ++) {
+                matc[i][j] = 0;
+                for (k = 0; k < MATSIZE; k ++) {
+                    matc[i][j] += mata[i][k] * matb[k][j];
+                }
+            }
+        }
+        for (i = 0; i < MATSIZE; i ++) {
+            for (j = 0; j < MATSIZE; j ++) {
+                mata[i][j] = matc[i][j] & 0xff;
+            }
+        }
+    }
+    return mata[0][0] & 0x7f;
+}
+
+int
+main(void) {
+    int pids[NR_WORKERS], i, code;
+    unsigned int time = gettime_msec();
+    for (i = 0; i < NR_WORKERS; i ++) {
+        if ((pids[i] = fork()) == 0) {
+            exit(work(i));
+        }
+        assert(pids[i] > 0);
+    }
+    for (i = 0; i < NR_WORKERS; i ++) {
+        assert(waitpid(pids[i], &code) == 0);
+    }
+    time = gettime_msec() - time;
+    cprintf("smpbench: %d workers x %d rounds of %dx%d matrix: %d msecs.\n",
+            NR_WORKERS, ROUNDS, MATSIZE, MATSIZE, time);
+    cprintf("smpbench pass.\n");
+    return 0;
+}
+
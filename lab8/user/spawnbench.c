@@ -0,0 +1,46 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* *
+ * spawnbench - command-launch latency, the way sh starts a command: fork
+ * or vfork a child that execs a program which exits at once, then wait
+ * for it. The parent has BUFPAGES of touched data, which fork copies
+ * through dup_mmap and vfork does not.
+ * */
+
+#define ROUNDS          50
+#define BUFPAGES        64
+
+static char buf[BUFPAGES * 4096];
+
+static unsigned int
+launch(int (*spawn)(void)) {
+    static const char *argv[] = {"/spawnbench", "-x", NULL};
+    unsigned int time = gettime_msec();
+    int i, pid, code;
+    for (i = 0; i < ROUNDS; i ++) {
+        if ((pid = spawn()) == 0) {
+            __exec(argv[0], argv);
+            exit(-1);
+        }
+        assert(pid > 0 && waitpid(pid, &code) == 0 && code == 0);
+    }
+    return gettime_msec() - time;
+}
+
+int
+main(int argc, char **argv) {
+    if (argc == 2) {
+        // the launched program
+        return 0;
+    }
+    memset(buf, 1, sizeof(buf));
+    unsigned int fork_time = launch(fork);
+    unsigned int vfork_time = launch(vfork);
+    cprintf("spawnbench: %d launches with %d pages: fork+exec %d msecs, vfork+exec %d msecs.\n",
+            ROUNDS, BUFPAGES, fork_time, vfork_time);
+    cprintf("spawnbench pass.\n");
+    return 0;
+}
+
@@ -0,0 +1,84 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <lock.h>
+#include <thread.h>
+
+/* *
+ * threadbench - check threads share memory but not their thread-local
+ * storage, then time creating and joining ROUNDS threads against forking
+ * and waiting for ROUNDS processes. A thread does not copy the page table,
+ * so it should be much the cheaper of the two.
+ * */
+
+#define NR_THREADS      8
+#define INCS            1000
+#define ROUNDS          200
+#define TLS_KEY         0
+
+static char stacks[NR_THREADS][THREAD_STACK_SIZE] __attribute__((aligned(16)));
+static lock_t counter_lock = INIT_LOCK;
+static volatile int counter;
+
+static int
+worker(void *arg) {
+    long id = (long)arg;
+    int i;
+    assert(thread_getspecific(TLS_KEY) == NULL);
+    thread_setspecific(TLS_KEY, (void *)(id + 1));
+    for (i = 0; i < INCS; i ++) {
+        lock(&counter_lock);
+        counter ++;
+        unlock(&counter_lock);
+        if (i % 100 == 0) {
+            yield();
+        }
+    }
+    // nobody else wrote our slot
+    assert(thread_getspecific(TLS_KEY) == (void *)(id + 1));
+    return id;
+}
+
+static int
+nothing(void *arg) {
+    return 0;
+}
+
+int
+main(void) {
+    thread_t threads[NR_THREADS];
+    int i, code;
+
+    thread_setspecific(TLS_KEY, (void *)-1);
+    for (i = 0; i < NR_THREADS; i ++) {
+        assert(thread_create(threads + i, stacks[i], THREAD_STACK_SIZE, worker, (void *)(long)i) == 0);
+    }
+    for (i = 0; i < NR_THREADS; i ++) {
+        assert(thread_join(threads + i, &code) == 0 && code == i);
+    }
+    assert(counter == NR_THREADS * INCS);
+    assert(thread_getspecific(TLS_KEY) == (void *)-1);
+    cprintf("threadbench: %d threads shared the counter.\n", NR_THREADS);
+
+    unsigned int time = gettime_msec();
+    for (i = 0; i < ROUNDS; i ++) {
+        assert(thread_create(threads, stacks[0], THREAD_STACK_SIZE, nothing, NULL) == 0);
+        assert(thread_join(threads, &code) == 0);
+    }
+    unsigned int thread_time = gettime_msec() - time;
+
+    int pid;
+    time = gettime_msec();
+    for (i = 0; i < ROUNDS; i ++) {
+        if ((pid = fork()) == 0) {
+            exit(0);
+        }
+        assert(pid > 0 && waitpid(pid, &code) == 0);
+    }
+    unsigned int fork_time = gettime_msec() - time;
+
+    cprintf("threadbench: %d x create+join: %d msecs, %d x fork+wait: %d msecs.\n",
+            ROUNDS, thread_time, ROUNDS, fork_time);
+    cprintf("threadbench pass.\n");
+    return 0;
+}
+